@@ -10,256 +10,4804 @@
 #include <semaphore.h>
 #include <algorithm>
 #include <iomanip>
+#include <cstdint>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+#include <string>
+#include <cmath>
+#include <queue>
+#include <functional>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define OSSIM_COROUTINES 1
+#else
+#define OSSIM_COROUTINES 0
+#endif
 
 /* =========================
-   PROCESS STRUCTURE
+   PROCESS TABLE
    ========================= */
-struct Process {
-    int pid;
-    int arrivalTime;
-    int burstTime;
-    int remainingTime;
-    std::vector<int> maxDemand;
+// Handle into the ProcessTable: a 22-bit row index and a 10-bit generation
+// that changes every time the row is released, so a handle kept past its
+// process's exit no longer validates. This is what the buffer, ready queue
+// and event list carry instead of Process pointers.
+typedef uint32_t ProcHandle;
+static const ProcHandle kNoProc = 0xffffffffu;
 
-    Process(int pid_, int at, int bt, const std::vector<int>& req)
-        : pid(pid_), arrivalTime(at), burstTime(bt),
-          remainingTime(bt), maxDemand(req) {}
+enum class ProcState : uint8_t { New, Ready, Running, Blocked, Suspended, Terminated };
+static const int kProcStates = 6;
+
+static const char* stateName(ProcState s) {
+    static const char* names[kProcStates] = { "new", "ready", "running", "blocked", "suspended", "terminated" };
+    return names[(int)s];
+}
+
+enum : uint8_t {
+    kProcLive = 1,           // row holds a process (not on the free list)
+    kProcHoldsResources = 2, // maxDemand granted by ResourceManager
+    kProcTried = 4           // popped at least once; hostNs holds the first try
+};
+
+// Process control blocks stored column-wise as a slot map. Rows live in
+// fixed-size chunks that never move, so the producer can add processes while
+// other threads read rows they were handed through the buffer; released rows
+// are reused from a free list, so the table only grows to the peak number of
+// live processes.
+class ProcessTable {
+public:
+    static const int kIndexBits = 22;
+    static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+    static const uint32_t kMaxRows = kIndexMask; // index kIndexMask is never used, keeping kNoProc invalid
+    static const int kChunkBits = 12;
+    static const uint32_t kChunkRows = 1u << kChunkBits;
+
+private:
+    static const uint32_t kMaxChunks = (kMaxRows + kChunkRows) / kChunkRows;
+    struct Chunk {
+        int pid[kChunkRows];
+        long long arrival[kChunkRows];
+        int burst[kChunkRows];
+        int remaining[kChunkRows];
+        long long hostNs[kChunkRows]; // host time enqueued, then of first try
+        uint16_t gen[kChunkRows];
+        uint8_t flags[kChunkRows];
+        ProcState state[kChunkRows];
+        int16_t lastCpu[kChunkRows];      // CPU of the last slice, -1 before the first
+        long long lastRan[kChunkRows];    // that CPU's work clock when the slice ended
+        std::vector<uint16_t> demand;  // kChunkRows x resource types
+        explicit Chunk(int nres) : demand((size_t)kChunkRows * nres) {}
+    };
+
+    int nres;
+    std::atomic<uint32_t> rows{ 0 }; // high-water mark
+    std::atomic<Chunk*> chunks[kMaxChunks];
+    std::vector<uint32_t> freeRows;
+    std::mutex slotMtx; // guards freeRows and growth
+    std::atomic<long long> live{ 0 };
+
+    Chunk* chunkOf(uint32_t row) const { return chunks[row >> kChunkBits].load(std::memory_order_acquire); }
+    static uint32_t row(ProcHandle h) { return h & kIndexMask; }
+    static uint32_t slot(ProcHandle h) { return h & (kChunkRows - 1); }
+
+public:
+    explicit ProcessTable(int resourceTypes) : nres(resourceTypes) {
+        for (uint32_t i = 0; i < kMaxChunks; i++) chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~ProcessTable() {
+        for (uint32_t i = 0; i < kMaxChunks; i++) delete chunks[i].load();
+    }
+
+    // kNoProc once kMaxRows processes are live at the same time.
+    ProcHandle create(int pid, long long arrival, int burst, const int* demand) {
+        uint32_t r;
+        Chunk* c;
+        {
+            std::lock_guard<std::mutex> lock(slotMtx);
+            if (!freeRows.empty()) {
+                r = freeRows.back();
+                freeRows.pop_back();
+                c = chunkOf(r);
+            }
+            else {
+                r = rows.load(std::memory_order_relaxed);
+                if (r >= kMaxRows) return kNoProc;
+                c = chunkOf(r);
+                if (!c) {
+                    c = new Chunk(nres);
+                    for (uint32_t i = 0; i < kChunkRows; i++) c->gen[i] = 0;
+                    chunks[r >> kChunkBits].store(c, std::memory_order_release);
+                }
+                rows.store(r + 1, std::memory_order_release);
+            }
+        }
+        uint32_t i = r & (kChunkRows - 1);
+        c->pid[i] = pid;
+        c->arrival[i] = arrival;
+        c->burst[i] = burst;
+        c->remaining[i] = burst;
+        c->hostNs[i] = 0;
+        c->flags[i] = kProcLive;
+        c->state[i] = ProcState::New;
+        c->lastCpu[i] = -1;
+        c->lastRan[i] = 0;
+        for (int k = 0; k < nres; k++) c->demand[(size_t)i * nres + k] = (uint16_t)demand[k];
+        live.fetch_add(1, std::memory_order_relaxed);
+        return ((uint32_t)c->gen[i] << kIndexBits) | r;
+    }
+
+    // Frees the row for reuse; h and every copy of it stop validating.
+    // Returns the process's PID, or -1 if h was already stale.
+    int release(ProcHandle h) {
+        if (!valid(h)) return -1;
+        Chunk* c = chunkOf(row(h));
+        uint32_t i = slot(h);
+        int pid = c->pid[i];
+        c->flags[i] = 0;
+        c->remaining[i] = 0;
+        c->gen[i] = (uint16_t)((c->gen[i] + 1) & ((1u << (32 - kIndexBits)) - 1));
+        live.fetch_sub(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(slotMtx);
+        freeRows.push_back(row(h));
+        return pid;
+    }
+
+    // Row of a valid handle, for side tables indexed like the table.
+    static uint32_t index(ProcHandle h) { return row(h); }
+
+    bool valid(ProcHandle h) const {
+        if (h == kNoProc || row(h) >= rows.load(std::memory_order_acquire)) return false;
+        Chunk* c = chunkOf(row(h));
+        return (c->flags[slot(h)] & kProcLive) && c->gen[slot(h)] == (h >> kIndexBits);
+    }
+
+    int& pid(ProcHandle h) { return chunkOf(row(h))->pid[slot(h)]; }
+    long long& arrival(ProcHandle h) { return chunkOf(row(h))->arrival[slot(h)]; }
+    int& burst(ProcHandle h) { return chunkOf(row(h))->burst[slot(h)]; }
+    int& remaining(ProcHandle h) { return chunkOf(row(h))->remaining[slot(h)]; }
+    long long& hostNs(ProcHandle h) { return chunkOf(row(h))->hostNs[slot(h)]; }
+    uint8_t& flags(ProcHandle h) { return chunkOf(row(h))->flags[slot(h)]; }
+    ProcState& state(ProcHandle h) { return chunkOf(row(h))->state[slot(h)]; }
+    int16_t& lastCpu(ProcHandle h) { return chunkOf(row(h))->lastCpu[slot(h)]; }
+    long long& lastRan(ProcHandle h) { return chunkOf(row(h))->lastRan[slot(h)]; }
+    const uint16_t* demand(ProcHandle h) { return &chunkOf(row(h))->demand[(size_t)slot(h) * nres]; }
+
+    int resourceTypes() const { return nres; }
+    uint32_t size() const { return rows.load(std::memory_order_acquire); }
+    long long liveCount() const { return live.load(std::memory_order_relaxed); }
+
+    // Unfinished work over all rows, one contiguous column run per chunk;
+    // released rows hold 0.
+    long long remainingWork() const {
+        long long sum = 0;
+        uint32_t n = size();
+        for (uint32_t base = 0; base < n; base += kChunkRows) {
+            const int* col = chunkOf(base)->remaining;
+            uint32_t len = std::min((uint32_t)kChunkRows, n - base);
+            for (uint32_t i = 0; i < len; i++) sum += col[i];
+        }
+        return sum;
+    }
+
+    // Live processes per ProcState, from the flags and state columns.
+    void countStates(long long counts[kProcStates]) const {
+        for (int k = 0; k < kProcStates; k++) counts[k] = 0;
+        uint32_t n = size();
+        for (uint32_t base = 0; base < n; base += kChunkRows) {
+            const Chunk* c = chunkOf(base);
+            uint32_t len = std::min((uint32_t)kChunkRows, n - base);
+            for (uint32_t i = 0; i < len; i++)
+                if (c->flags[i] & kProcLive) counts[(int)c->state[i]]++;
+        }
+    }
+
+    // One process's share of the columns: the size of its control block.
+    size_t rowBytes() const { return (sizeof(Chunk) - sizeof(std::vector<uint16_t>)) / kChunkRows + nres * sizeof(uint16_t); }
+
+    size_t bytes() const {
+        size_t perChunk = sizeof(Chunk) + (size_t)kChunkRows * nres * sizeof(uint16_t);
+        return ((size() + kChunkRows - 1) / kChunkRows) * perChunk + sizeof(*this);
+    }
+};
+
+/* =========================
+   PID ALLOCATOR
+   ========================= */
+// PIDs 1..pidMax-1 handed out cyclically from a two-level bitmap, as in the
+// Linux pidmap: a bit per PID, plus a summary bit per 64-PID word that is
+// set while the word is full, so find-first-zero skips full regions 4096
+// PIDs at a time. Exited PIDs are recycled once the cursor wraps around.
+class PidAllocator {
+public:
+    static const int kBatch = 16;
+
+    // PIDs reserved by one thread so most alloc(Batch&) calls skip the lock;
+    // whatever is left goes back to the allocator when the batch is destroyed.
+    class Batch {
+        friend class PidAllocator;
+        PidAllocator* owner;
+        int pids[kBatch];
+        int n = 0;
+    public:
+        explicit Batch(PidAllocator* a) : owner(a) {}
+        ~Batch() { owner->releaseMany(pids, n); }
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+    };
+
+private:
+    int pidMax;
+    std::vector<uint64_t> used; // bit per PID
+    std::vector<uint64_t> full; // bit per word of used with no zero bit
+    int last = 0;               // most recently allocated PID
+    long long inUse = 0;
+    std::mutex mtx;
+
+    void mark(int pid) {
+        int w = pid >> 6;
+        used[w] |= 1ull << (pid & 63);
+        if (used[w] == ~0ull) full[w >> 6] |= 1ull << (w & 63);
+    }
+
+    void unmark(int pid) {
+        int w = pid >> 6;
+        used[w] &= ~(1ull << (pid & 63));
+        full[w >> 6] &= ~(1ull << (w & 63));
+    }
+
+    // First free PID at or after from, or -1. Bits past pidMax are pre-marked.
+    int findFrom(int from) const {
+        if (from >= pidMax) return -1;
+        int w = from >> 6;
+        uint64_t open = ~used[w] & (~0ull << (from & 63));
+        if (open) return (w << 6) + __builtin_ctzll(open);
+        for (int nw = w + 1; (size_t)(nw >> 6) < full.size(); nw = ((nw >> 6) + 1) << 6) {
+            uint64_t notFull = ~full[nw >> 6] & (~0ull << (nw & 63));
+            if (notFull) {
+                nw = ((nw >> 6) << 6) + __builtin_ctzll(notFull);
+                return (nw << 6) + __builtin_ctzll(~used[nw]);
+            }
+        }
+        return -1;
+    }
+
+    int allocLocked() {
+        int pid = findFrom(last + 1);
+        if (pid < 0) pid = findFrom(1);
+        if (pid < 0) return -1;
+        mark(pid);
+        last = pid;
+        inUse++;
+        return pid;
+    }
+
+    void releaseLocked(int pid) {
+        if (pid <= 0 || pid >= pidMax || !(used[pid >> 6] & (1ull << (pid & 63)))) return;
+        unmark(pid);
+        inUse--;
+    }
+
+public:
+    explicit PidAllocator(int max) : pidMax(max) {
+        size_t words = ((size_t)max + 63) / 64;
+        used.assign(words, 0);
+        full.assign((words + 63) / 64, 0);
+        mark(0);
+        for (size_t pid = max; pid < words * 64; pid++) mark((int)pid);
+        for (size_t w = words; w < full.size() * 64; w++) full[w >> 6] |= 1ull << (w & 63);
+    }
+
+    // -1 when every PID is in use.
+    int alloc() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return allocLocked();
+    }
+
+    int alloc(Batch& b) {
+        if (b.n == 0) {
+            std::lock_guard<std::mutex> lock(mtx);
+            while (b.n < kBatch) {
+                int pid = allocLocked();
+                if (pid < 0) break;
+                b.pids[b.n++] = pid;
+            }
+            std::reverse(b.pids, b.pids + b.n); // hand out in ascending order
+        }
+        return b.n > 0 ? b.pids[--b.n] : -1;
+    }
+
+    void release(int pid) {
+        std::lock_guard<std::mutex> lock(mtx);
+        releaseLocked(pid);
+    }
+
+    void releaseMany(const int* pids, int n) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int i = 0; i < n; i++) releaseLocked(pids[i]);
+    }
+
+    long long allocated() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return inUse;
+    }
+
+    int max() const { return pidMax; }
+};
+
+/* =========================
+   LOCK PROFILING
+   ========================= */
+// Build with -DOSSIM_LOCK_PROFILING=1 to record, per named lock, acquisitions,
+// contended acquisitions, wait time and hold time, reported at shutdown.
+// Otherwise SimMutex is a plain std::mutex.
+#ifndef OSSIM_LOCK_PROFILING
+#define OSSIM_LOCK_PROFILING 0
+#endif
+
+struct LockStats {
+    const char* name;
+    std::atomic<unsigned long long> acquisitions{ 0 }, contended{ 0 };
+    std::atomic<unsigned long long> waitNs{ 0 }, maxWaitNs{ 0 }, holdNs{ 0 };
+
+    explicit LockStats(const char* n) : name(n) {}
+
+    // Every lock sharing a name (e.g. each run's Scheduler) shares its stats.
+    static LockStats* get(const char* name) {
+        std::lock_guard<std::mutex> lock(registryMtx());
+        for (auto& s : registry())
+            if (std::strcmp(s->name, name) == 0) return s.get();
+        registry().emplace_back(new LockStats(name));
+        return registry().back().get();
+    }
+
+    static void report(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(registryMtx());
+        if (registry().empty()) return;
+        os << "\n=== LOCK PROFILE ===\n" << std::left << std::setw(22) << "lock" << std::right
+           << std::setw(12) << "acquired" << std::setw(12) << "contended" << std::setw(14) << "wait ms"
+           << std::setw(14) << "max wait us" << std::setw(14) << "avg hold ns" << "\n";
+        for (auto& s : registry()) {
+            unsigned long long n = s->acquisitions.load();
+            os << std::left << std::setw(22) << s->name << std::right << std::setw(12) << n
+               << std::setw(12) << s->contended.load() << std::setw(14) << s->waitNs.load() / 1e6
+               << std::setw(14) << s->maxWaitNs.load() / 1e3 << std::setw(14) << (n ? s->holdNs.load() / n : 0) << "\n";
+        }
+    }
+
+private:
+    static std::mutex& registryMtx() { static std::mutex m; return m; }
+    static std::vector<std::unique_ptr<LockStats>>& registry() {
+        static std::vector<std::unique_ptr<LockStats>> r;
+        return r;
+    }
+};
+
+// Drop-in for std::mutex (works with lock_guard and unique_lock).
+class ProfiledMutex {
+private:
+    std::mutex m;
+    LockStats* stats;
+    std::chrono::steady_clock::time_point acquiredAt;
+
+public:
+    explicit ProfiledMutex(const char* name) : stats(LockStats::get(name)) {}
+
+    void lock() {
+        if (!m.try_lock()) {
+            auto t0 = std::chrono::steady_clock::now();
+            m.lock();
+            unsigned long long w = (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+            stats->contended.fetch_add(1, std::memory_order_relaxed);
+            stats->waitNs.fetch_add(w, std::memory_order_relaxed);
+            unsigned long long prev = stats->maxWaitNs.load(std::memory_order_relaxed);
+            while (w > prev && !stats->maxWaitNs.compare_exchange_weak(prev, w, std::memory_order_relaxed)) {}
+        }
+        stats->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        acquiredAt = std::chrono::steady_clock::now();
+    }
+
+    bool try_lock() {
+        if (!m.try_lock()) return false;
+        stats->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        acquiredAt = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void unlock() {
+        stats->holdNs.fetch_add((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - acquiredAt).count(), std::memory_order_relaxed);
+        m.unlock();
+    }
+};
+
+#if OSSIM_LOCK_PROFILING
+typedef ProfiledMutex SimMutex;
+#else
+class SimMutex : public std::mutex {
+public:
+    explicit SimMutex(const char*) {}
+};
+#endif
+
+/* =========================
+   GLOBAL CONTROL
+   ========================= */
+static uint64_t gSeed = 0;
+SimMutex gIoMtx{ "gIoMtx" };
+
+/* =========================
+   LOGGING
+   ========================= */
+// Compile-time level: 0 off, 1 warn, 2 info, 3 debug. Calls above the level
+// expand to nothing, e.g. g++ -DOSSIM_LOG_LEVEL=0 for benchmark builds.
+#ifndef OSSIM_LOG_LEVEL
+#define OSSIM_LOG_LEVEL 2
+#endif
+
+struct LogRecord {
+    const char* tag; // string literals only: records outlive the call
+    const char* msg;
+    long long arg;
+};
+
+// Single-producer ring owned by one thread; the writer is its only consumer.
+class LogRing {
+private:
+    static const size_t kSize = 4096; // power of two
+    LogRecord slots[kSize];
+    std::atomic<size_t> head{ 0 }, tail{ 0 };
+
+public:
+    std::atomic<unsigned long long> dropped{ 0 };
+
+    bool push(const LogRecord& r) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == kSize) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & (kSize - 1)] = r;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t drain(std::string& out) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        for (size_t i = t; i != h; i++) {
+            const LogRecord& r = slots[i & (kSize - 1)];
+            out += '[';
+            out += r.tag;
+            out += "] ";
+            out += r.msg;
+            out += ' ';
+            out += std::to_string(r.arg);
+            out += '\n';
+        }
+        tail.store(h, std::memory_order_release);
+        return h - t;
+    }
+};
+
+// Per-thread rings drained in batches by one background writer, so logging
+// threads never take gIoMtx or flush on the hot path.
+class Logger {
+private:
+    std::mutex regMtx; // guards rings; taken once per thread and by the writer
+    std::vector<std::unique_ptr<LogRing>> rings;
+    std::ostream* sink = &std::cout;
+    std::thread writer;
+    std::atomic<bool> stopping{ false };
+
+    Logger() {}
+
+    size_t flushOnce() {
+        std::string batch;
+        size_t n = 0;
+        {
+            std::lock_guard<std::mutex> lock(regMtx);
+            for (auto& r : rings) n += r->drain(batch);
+        }
+        if (n) {
+            std::lock_guard<SimMutex> lock(gIoMtx);
+            sink->write(batch.data(), batch.size());
+            sink->flush();
+        }
+        return n;
+    }
+
+    void writerLoop() {
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (flushOnce() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        flushOnce();
+    }
+
+public:
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    void log(const char* tag, const char* msg, long long arg) {
+        static thread_local LogRing* ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(regMtx);
+            rings.emplace_back(new LogRing());
+            ring = rings.back().get();
+        }
+        ring->push(LogRecord{ tag, msg, arg });
+    }
+
+    void start() {
+        stopping = false;
+        if (!writer.joinable()) writer = std::thread(&Logger::writerLoop, this);
+    }
+
+    // Stops the writer after a final drain of every ring.
+    void stop() {
+        stopping = true;
+        if (writer.joinable()) writer.join();
+    }
+
+    // Only while the writer is stopped.
+    void setSink(std::ostream* os) { sink = os; }
+
+    unsigned long long dropped() {
+        std::lock_guard<std::mutex> lock(regMtx);
+        unsigned long long n = 0;
+        for (auto& r : rings) n += r->dropped.load();
+        return n;
+    }
+};
+
+#if OSSIM_LOG_LEVEL >= 1
+#define LOG_WARN(tag, msg, arg) Logger::instance().log(tag, msg, arg)
+#else
+#define LOG_WARN(tag, msg, arg) ((void)0)
+#endif
+#if OSSIM_LOG_LEVEL >= 2
+#define LOG_INFO(tag, msg, arg) Logger::instance().log(tag, msg, arg)
+#else
+#define LOG_INFO(tag, msg, arg) ((void)0)
+#endif
+#if OSSIM_LOG_LEVEL >= 3
+#define LOG_DEBUG(tag, msg, arg) Logger::instance().log(tag, msg, arg)
+#else
+#define LOG_DEBUG(tag, msg, arg) ((void)0)
+#endif
+
+/* =========================
+   RANDOM HELPERS
+   ========================= */
+// Stream ids: fixed streams for the simulator's own threads, and one stream
+// per simulated entity (e.g. per PID) above kStreamEntityBase.
+enum : uint64_t {
+    kStreamProducer = 1,
+    kStreamReplicas = 2,
+    kStreamKmem = 3,
+    kStreamEntityBase = 1ULL << 32
+};
+
+// Counter-based generator: output n of a stream is mix(key + n * gamma) with
+// key derived from (seed, stream), so every stream is independent and fully
+// reproducible, and a block of outputs needs no state besides the counter.
+class Rng {
+private:
+    uint64_t key, ctr = 0;
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    static const uint64_t kGamma = 0x9e3779b97f4a7c15ULL;
+
+    Rng(uint64_t seed, uint64_t stream) : key(mix(seed ^ mix(stream * kGamma + 1))) {}
+
+    static Rng forEntity(uint64_t seed, uint64_t id) { return Rng(seed, kStreamEntityBase + id); }
+
+    uint64_t next() { return mix(key + (++ctr) * kGamma); }
+
+    // Uniform in [lo, hi] via multiply-shift (no division, no per-call object).
+    int uniformInt(int lo, int hi) {
+        uint64_t range = (uint64_t)((int64_t)hi - lo + 1);
+        return lo + (int)(((next() >> 32) * range) >> 32);
+    }
+
+    // Uniform in [0, 1) with 53 bits of precision.
+    double uniform01() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Bulk API: fills out[0..n) with uniform ints in [lo, hi].
+    void fillInt(int* out, size_t n, int lo, int hi) {
+        uint64_t range = (uint64_t)((int64_t)hi - lo + 1);
+        uint64_t base = key, c = ctr;
+        for (size_t i = 0; i < n; i++)
+            out[i] = lo + (int)(((mix(base + (++c) * kGamma) >> 32) * range) >> 32);
+        ctr = c;
+    }
+
+    void fill01(double* out, size_t n) {
+        uint64_t base = key, c = ctr;
+        for (size_t i = 0; i < n; i++)
+            out[i] = (mix(base + (++c) * kGamma) >> 11) * (1.0 / 9007199254740992.0);
+        ctr = c;
+    }
+};
+
+/* =========================
+   WORKLOAD MODELS
+   ========================= */
+static double sampleExp(Rng& rng, double rate) {
+    return -std::log(1.0 - rng.uniform01()) / rate;
+}
+
+static double sampleNormal(Rng& rng) {
+    double u1 = 1.0 - rng.uniform01(), u2 = rng.uniform01();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+}
+
+// Splits "name:a:b:c" into its name and numeric fields.
+static bool parseSpec(const std::string& spec, std::string& name, std::vector<double>& args) {
+    size_t pos = spec.find(':');
+    name = spec.substr(0, pos);
+    args.clear();
+    while (pos != std::string::npos) {
+        size_t start = pos + 1;
+        pos = spec.find(':', start);
+        std::string field = spec.substr(start, pos == std::string::npos ? std::string::npos : pos - start);
+        char* end = nullptr;
+        double v = std::strtod(field.c_str(), &end);
+        if (field.empty() || *end != '\0') return false;
+        args.push_back(v);
+    }
+    return !name.empty();
+}
+
+// CPU burst length distribution, in scheduler time units (always >= 1).
+struct BurstModel {
+    enum Kind { Uniform, Exponential, LogNormal, BoundedPareto };
+    Kind kind = Uniform;
+    std::string spec = "uniform:2:6";
+    double a = 2, b = 6, c = 0; // uniform [a,b] | exp mean a | lognormal mu a, sigma b | pareto alpha a on [b,c]
+
+    BurstModel() {}
+    explicit BurstModel(const std::string& s) { parse(s); }
+
+    int sample(Rng& rng) const {
+        double x;
+        switch (kind) {
+        case Uniform: return rng.uniformInt((int)a, (int)b);
+        case Exponential: x = sampleExp(rng, 1.0 / a); break;
+        case LogNormal: x = std::exp(a + b * sampleNormal(rng)); break;
+        default: {
+            double u = rng.uniform01();
+            x = b / std::pow(1.0 - u * (1.0 - std::pow(b / c, a)), 1.0 / a);
+            break;
+        }
+        }
+        return std::max(1, (int)std::lround(x));
+    }
+
+    void fill(Rng& rng, int* out, size_t n) const {
+        if (kind == Uniform) { rng.fillInt(out, n, (int)a, (int)b); return; }
+        for (size_t i = 0; i < n; i++) out[i] = sample(rng);
+    }
+
+    // "uniform:LO:HI", "exp:MEAN", "lognormal:MU:SIGMA", "pareto:ALPHA:LO:HI"
+    bool parse(const std::string& spec) {
+        std::string name;
+        std::vector<double> v;
+        if (!parseSpec(spec, name, v)) return false;
+        if (name == "uniform" && v.size() == 2 && v[0] >= 1 && v[1] >= v[0]) kind = Uniform;
+        else if (name == "exp" && v.size() == 1 && v[0] > 0) kind = Exponential;
+        else if (name == "lognormal" && v.size() == 2 && v[1] >= 0) kind = LogNormal;
+        else if (name == "pareto" && v.size() == 3 && v[0] > 0 && v[1] > 0 && v[2] > v[1]) kind = BoundedPareto;
+        else return false;
+        a = v[0];
+        b = v.size() > 1 ? v[1] : 0;
+        c = v.size() > 2 ? v[2] : 0;
+        this->spec = spec;
+        return true;
+    }
+};
+
+// Arrival process parameters; rates are arrivals per time unit.
+struct ArrivalModel {
+    enum Kind { Fixed, Poisson, Mmpp, Diurnal };
+    Kind kind = Fixed;
+    std::string spec = "fixed:0.5";
+    double rate = 0.5;
+    double burstRate = 0, calmMean = 0, burstMean = 0; // MMPP: second state and mean sojourns
+    double amplitude = 0, period = 0;                 // Diurnal: rate * (1 + amplitude * sin(2*pi*t / period))
+
+    // "fixed:RATE", "poisson:RATE", "mmpp:RATE:BURST_RATE:CALM_MEAN:BURST_MEAN",
+    // "diurnal:RATE:AMPLITUDE:PERIOD"
+    bool parse(const std::string& spec) {
+        std::string name;
+        std::vector<double> v;
+        if (!parseSpec(spec, name, v) || v.empty() || v[0] <= 0) return false;
+        if (name == "fixed" && v.size() == 1) kind = Fixed;
+        else if (name == "poisson" && v.size() == 1) kind = Poisson;
+        else if (name == "mmpp" && v.size() == 4 && v[1] > 0 && v[2] > 0 && v[3] > 0) {
+            kind = Mmpp;
+            burstRate = v[1]; calmMean = v[2]; burstMean = v[3];
+        }
+        else if (name == "diurnal" && v.size() == 3 && v[1] >= 0 && v[1] <= 1 && v[2] > 0) {
+            kind = Diurnal;
+            amplitude = v[1]; period = v[2];
+        }
+        else return false;
+        rate = v[0];
+        this->spec = spec;
+        return true;
+    }
+};
+
+// Stateful sampler of inter-arrival gaps for one arrival stream.
+class ArrivalProcess {
+private:
+    ArrivalModel m;
+    bool bursting = false;
+    double sojournLeft = -1;
+
+public:
+    explicit ArrivalProcess(const ArrivalModel& model) : m(model) {}
+
+    double nextGap(Rng& rng, double now) {
+        switch (m.kind) {
+        case ArrivalModel::Fixed: return 1.0 / m.rate;
+        case ArrivalModel::Poisson: return sampleExp(rng, m.rate);
+        case ArrivalModel::Mmpp: {
+            // Memoryless in both states: draw in the current state and switch
+            // whenever the state's sojourn runs out first.
+            double gap = 0;
+            if (sojournLeft < 0) sojournLeft = sampleExp(rng, 1.0 / m.calmMean);
+            while (true) {
+                double e = sampleExp(rng, bursting ? m.burstRate : m.rate);
+                if (e < sojournLeft) { sojournLeft -= e; return gap + e; }
+                gap += sojournLeft;
+                bursting = !bursting;
+                sojournLeft = sampleExp(rng, 1.0 / (bursting ? m.burstMean : m.calmMean));
+            }
+        }
+        default: {
+            // Non-homogeneous Poisson by thinning against the peak rate.
+            double peak = m.rate * (1 + m.amplitude), t = now;
+            while (true) {
+                t += sampleExp(rng, peak);
+                double r = m.rate * (1 + m.amplitude * std::sin(6.283185307179586 * t / m.period));
+                if (rng.uniform01() * peak <= r) return t - now;
+            }
+        }
+        }
+    }
+};
+
+// A simulated I/O device: one server with a FIFO queue and its own
+// service-time distribution.
+struct IoDeviceModel {
+    std::string name;
+    BurstModel service;
+};
+
+// Memory reference stream of each process, in bytes of its own address
+// space, consumed by the CPU cache model.
+struct AccessPattern {
+    enum Kind { Random, Stride, Trace };
+    Kind kind = Stride;
+    std::string spec = "stride:65536:8:0.05";
+    uint64_t ws = 65536;  // working set, bytes
+    uint64_t stride = 8;
+    double jump = 0.05;   // chance per access of jumping to a random spot
+    std::shared_ptr<const std::vector<uint64_t>> trace; // recorded addresses
+    int rate = 100;       // accesses per time unit of CPU
+
+    // "random:WS", "stride:WS:STRIDE:JUMP", "trace:FILE" (one address per
+    // line, hex with 0x or decimal, '#' comments)
+    bool parse(const std::string& spec) {
+        if (spec.compare(0, 6, "trace:") == 0) {
+            std::ifstream in(spec.substr(6));
+            if (!in) return false;
+            std::shared_ptr<std::vector<uint64_t>> addrs = std::make_shared<std::vector<uint64_t>>();
+            std::string line;
+            while (std::getline(in, line)) {
+                line = line.substr(0, line.find('#'));
+                if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+                char* end = nullptr;
+                uint64_t a = std::strtoull(line.c_str(), &end, 0);
+                if (end == line.c_str()) return false;
+                addrs->push_back(a);
+            }
+            if (addrs->empty()) return false;
+            kind = Trace;
+            trace = addrs;
+        }
+        else {
+            std::string name;
+            std::vector<double> v;
+            if (!parseSpec(spec, name, v) || v.empty() || v[0] < 8 || v[0] > 4294967296.0) return false;
+            if (name == "random" && v.size() == 1) kind = Random;
+            else if (name == "stride" && v.size() == 3 && v[1] >= 1 && v[1] <= v[0] && v[2] >= 0 && v[2] <= 1) {
+                kind = Stride;
+                stride = (uint64_t)v[1];
+                jump = v[2];
+            }
+            else return false;
+            ws = (uint64_t)v[0];
+            trace.reset();
+        }
+        this->spec = spec;
+        return true;
+    }
+};
+
+struct Workload {
+    ArrivalModel arrival;
+    BurstModel burst;
+    std::vector<IoDeviceModel> devices{ IoDeviceModel{ "io", BurstModel("exp:10") } };
+    std::string devicesSpec = "io@exp:10";
+    int ioLo = 0, ioHi = 0;      // I/O waits per process; 0:0 runs plain CPU bursts
+    double ioBound = 1;          // fraction of processes that do I/O; the rest are CPU-bound
+    int demandLo = 1, demandHi = 2;
+    AccessPattern access;
+    int msPerUnit = 1000; // wall-clock length of one time unit in interactive mode
+};
+
+/* =========================
+   PROCESS BEHAVIOR
+   ========================= */
+// One step of a simulated process, handed to the engine when the previous
+// step is over.
+struct SimAction {
+    enum Kind { Cpu, Io, Exit };
+    Kind kind;
+    int amount; // Cpu: time units; Io: device index
+};
+
+#if OSSIM_COROUTINES
+// A process body written as straight-line code: each co_yield hands a CPU
+// burst or I/O wait to the engine, which resumes the coroutine when that step
+// completes. Suspended frames live on the heap, so a single host thread can
+// carry any number of processes.
+class SimTask {
+public:
+    struct promise_type {
+        SimAction current{ SimAction::Exit, 0 };
+        SimTask get_return_object() { return SimTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(SimAction a) noexcept { current = a; return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    SimTask() {}
+    SimTask(SimTask&& o) noexcept : h(o.h) { o.h = nullptr; }
+    SimTask& operator=(SimTask&& o) noexcept {
+        if (this != &o) {
+            if (h) h.destroy();
+            h = o.h;
+            o.h = nullptr;
+        }
+        return *this;
+    }
+    ~SimTask() { if (h) h.destroy(); }
+
+    // Runs the body to its next step; Exit once it has returned.
+    SimAction next() {
+        if (!h || h.done()) return SimAction{ SimAction::Exit, 0 };
+        h.resume();
+        return h.done() ? SimAction{ SimAction::Exit, 0 } : h.promise().current;
+    }
+
+private:
+    explicit SimTask(std::coroutine_handle<promise_type> c) : h(c) {}
+    std::coroutine_handle<promise_type> h;
+};
+
+// A CPU burst, then ioWaits rounds of I/O on a random device and CPU burst,
+// drawn from the engine's stream as the process gets there.
+static SimTask phasedProcess(Rng* rng, const Workload* wl, int ioWaits) {
+    co_yield SimAction{ SimAction::Cpu, wl->burst.sample(*rng) };
+    for (int i = 0; i < ioWaits; i++) {
+        co_yield SimAction{ SimAction::Io, rng->uniformInt(0, (int)wl->devices.size() - 1) };
+        co_yield SimAction{ SimAction::Cpu, wl->burst.sample(*rng) };
+    }
+}
+#else
+// Pre-C++20 builds: phasedProcess as a hand-written state machine.
+class SimTask {
+    Rng* rng = nullptr;
+    const Workload* wl = nullptr;
+    int ioWaits = 0, step = 0;
+
+public:
+    SimTask() {}
+    SimTask(Rng* r, const Workload* w, int n) : rng(r), wl(w), ioWaits(n) {}
+
+    SimAction next() {
+        if (!rng || step > 2 * ioWaits) return SimAction{ SimAction::Exit, 0 };
+        if (step++ % 2 == 1) return SimAction{ SimAction::Io, rng->uniformInt(0, (int)wl->devices.size() - 1) };
+        return SimAction{ SimAction::Cpu, wl->burst.sample(*rng) };
+    }
+};
+
+static SimTask phasedProcess(Rng* rng, const Workload* wl, int ioWaits) { return SimTask(rng, wl, ioWaits); }
+#endif
+
+/* =========================
+   CPU CACHE
+   ========================= */
+// Geometry and replacement policy of one simulated CPU's cache.
+struct CacheGeometry {
+    enum Policy { Lru, Plru };
+    Policy policy = Lru;
+    std::string spec; // empty: no cache model
+    long long size = 0;
+    int ways = 0, line = 0;
+
+    bool enabled() const { return size > 0; }
+
+    // "lru:SIZE:WAYS:LINE" or "plru:SIZE:WAYS:LINE", sizes in bytes. Sets and
+    // lines must be powers of two; LRU allows up to 16 ways, PLRU a power of
+    // two up to 64.
+    bool parse(const std::string& spec) {
+        std::string name;
+        std::vector<double> v;
+        if (!parseSpec(spec, name, v) || v.size() != 3) return false;
+        long long sz = (long long)v[0];
+        int w = (int)v[1], ln = (int)v[2];
+        auto pow2 = [](long long x) { return x > 0 && (x & (x - 1)) == 0; };
+        if (w < 1 || !pow2(ln) || sz % ((long long)w * ln) != 0 || !pow2(sz / ((long long)w * ln))) return false;
+        if (name == "lru" && w <= 16) policy = Lru;
+        else if (name == "plru" && w <= 64 && pow2(w)) policy = Plru;
+        else return false;
+        size = sz;
+        ways = w;
+        line = ln;
+        this->spec = spec;
+        return true;
+    }
+};
+
+// Set-associative cache keyed by line number. Each way's tag and valid bit
+// share one word (tag + 1, 0 when empty), and an 8-bit signature of the tag
+// is packed eight ways to a word, so a lookup tests eight ways at once with
+// SWAR byte compares and reads full tags only on a signature match. A set's
+// replacement state is a single word: for LRU a stack of 4-bit way numbers,
+// most recent first; for PLRU the ways-1 bits of a binary tree, each
+// pointing toward the colder half.
+class SetAssocCache {
+    static const uint64_t kNibbles = 0x1111111111111111ULL;
+    static const uint64_t kBytes = 0x0101010101010101ULL;
+    static const uint64_t kLow7 = 0x7f7f7f7f7f7f7f7fULL;
+
+    CacheGeometry::Policy policy = CacheGeometry::Lru;
+    int ways = 0, words = 0, lineBits = 0, setBits = 0;
+    uint64_t setMask = 0, lastWordWays = 0; // high bit of each used byte in a set's last signature word
+    std::vector<uint64_t> tags;  // sets x ways
+    std::vector<uint64_t> sigs;  // sets x words, 0 bytes for empty ways
+    std::vector<uint64_t> state; // per set
+    uint64_t hits = 0, misses = 0;
+    uint64_t lastLine = ~0ULL; // line of the previous access
+
+    void touch(uint64_t& st, int w) {
+        if (policy == CacheGeometry::Lru) {
+            // Find w's rank (first zero nibble of st ^ w...w), move it to the front.
+            uint64_t x = st ^ (kNibbles * (uint64_t)w);
+            int r = __builtin_ctzll((x - kNibbles) & ~x & (kNibbles << 3)) >> 2;
+            uint64_t below = r ? st & (~0ULL >> (64 - 4 * r)) : 0;
+            uint64_t above = r < 15 ? st & (~0ULL << (4 * (r + 1))) : 0;
+            st = above | (below << 4) | (uint64_t)w;
+        }
+        else {
+            for (unsigned n = (unsigned)(w + ways); n > 1; n >>= 1) {
+                // Point the parent at n's sibling.
+                if (n & 1) st &= ~(1ULL << (n >> 1));
+                else st |= 1ULL << (n >> 1);
+            }
+        }
+    }
+
+    // 0x80 in each zero byte of x, exactly (no borrow between bytes).
+    static uint64_t zeroBytes(uint64_t x) { return ~(((x & kLow7) + kLow7) | x | kLow7); }
+
+    // Empties way w; fills take empty ways before asking the policy.
+    void clearWay(uint64_t set, int w) {
+        tags[set * ways + w] = 0;
+        sigs[set * words + (w >> 3)] &= ~(0xffULL << (8 * (w & 7)));
+    }
+
+    int victim(uint64_t st) const {
+        if (policy == CacheGeometry::Lru) return (int)((st >> (4 * (ways - 1))) & 15);
+        unsigned n = 1;
+        while (n < (unsigned)ways) n = 2 * n + (unsigned)((st >> n) & 1);
+        return (int)(n - (unsigned)ways);
+    }
+
+public:
+    SetAssocCache() {}
+    explicit SetAssocCache(const CacheGeometry& g) { configure(g); }
+
+    void configure(const CacheGeometry& g) {
+        policy = g.policy;
+        ways = g.ways;
+        lineBits = __builtin_ctzll((uint64_t)g.line);
+        uint64_t sets = (uint64_t)(g.size / ((long long)g.ways * g.line));
+        setBits = __builtin_ctzll(sets);
+        setMask = sets - 1;
+        words = (ways + 7) / 8;
+        lastWordWays = ~kLow7 >> (8 * (words * 8 - ways));
+        tags.assign(sets * ways, 0);
+        sigs.assign(sets * words, 0);
+        flush();
+    }
+
+    // Invalidates every line; counters are kept.
+    void flush() {
+        std::fill(tags.begin(), tags.end(), 0);
+        std::fill(sigs.begin(), sigs.end(), 0);
+        lastLine = ~0ULL;
+        state.assign(setMask + 1, policy == CacheGeometry::Lru ? 0xfedcba9876543210ULL : 0);
+    }
+
+    // Drops line number `ln` if resident. True if it was.
+    bool invalidateLine(uint64_t ln) {
+        uint64_t set = ln & setMask;
+        uint64_t tag = (ln >> setBits) + 1;
+        for (int w = 0; w < ways; w++)
+            if (tags[set * ways + w] == tag) {
+                clearWay(set, w);
+                if (ln == lastLine) lastLine = ~0ULL;
+                return true;
+            }
+        return false;
+    }
+
+    // Drops every resident line for which drop(line number) is true.
+    template <typename F>
+    void invalidateIf(F drop) {
+        for (uint64_t set = 0; set <= setMask; set++)
+            for (int w = 0; w < ways; w++) {
+                uint64_t t = tags[set * ways + w];
+                if (t && drop(((t - 1) << setBits) | set)) clearWay(set, w);
+            }
+        lastLine = ~0ULL;
+    }
+
+    // Looks up line number `ln`, filling it on a miss. True on a hit.
+    bool accessLine(uint64_t ln) {
+        if (ln == lastLine) {
+            // Still resident and already most recent in its set.
+            hits++;
+            return true;
+        }
+        uint64_t set = ln & setMask;
+        uint64_t tag = (ln >> setBits) + 1;
+        uint64_t* t = &tags[set * ways];
+        uint64_t* sg = &sigs[set * words];
+        uint64_t& st = state[set];
+        uint64_t sig = ((tag * 0x9e3779b97f4a7c15ULL) >> 57) + 1; // 1..128
+        for (int k = 0; k < words; k++) {
+            for (uint64_t m = zeroBytes(sg[k] ^ (sig * kBytes)); m; m &= m - 1) {
+                int w = k * 8 + (__builtin_ctzll(m) >> 3);
+                if (t[w] == tag) {
+                    touch(st, w);
+                    hits++;
+                    lastLine = ln;
+                    return true;
+                }
+            }
+        }
+        int w = -1;
+        for (int k = 0; k < words && w < 0; k++) {
+            uint64_t m = zeroBytes(sg[k]) & (k == words - 1 ? lastWordWays : ~kLow7);
+            if (m) w = k * 8 + (__builtin_ctzll(m) >> 3);
+        }
+        if (w < 0) w = victim(st);
+        t[w] = tag;
+        int shift = 8 * (w & 7);
+        sg[w >> 3] = (sg[w >> 3] & ~(0xffULL << shift)) | (sig << shift);
+        touch(st, w);
+        misses++;
+        lastLine = ln;
+        return false;
+    }
+
+    bool access(uint64_t addr) { return accessLine(addr >> lineBits); }
+
+    uint64_t hitCount() const { return hits; }
+    uint64_t missCount() const { return misses; }
+    size_t bytes() const { return (tags.size() + sigs.size() + state.size()) * sizeof(uint64_t); }
+};
+
+// Per-CPU TLB: a SetAssocCache of translations, one entry per page. With
+// ASIDs, entries are tagged with the address space, and a process keeps
+// them across switches while it holds one of its CPU's ASIDs; without,
+// every switch to another process flushes the TLB.
+struct TlbConfig {
+    CacheGeometry entries; // ENTRIES one-byte lines; off unless set
+    std::string spec;
+    int asids = 0;         // per CPU; 0 flushes on every switch
+    int walkRefs = 4;      // memory references per miss (one per page table level)
+    int shootdown = 0;     // time units charged to each CPU told to drop an entry
+
+    bool enabled() const { return entries.enabled(); }
+
+    // "lru:ENTRIES:WAYS" or "plru:ENTRIES:WAYS", same limits as the cache.
+    bool parse(const std::string& spec) {
+        std::string name;
+        std::vector<double> v;
+        if (!parseSpec(spec, name, v) || v.size() != 2) return false;
+        CacheGeometry g;
+        if (!g.parse(name + ":" + std::to_string((long long)v[0]) + ":" + std::to_string((int)v[1]) + ":1")) return false;
+        entries = g;
+        this->spec = spec;
+        return true;
+    }
+};
+
+// One process's position in its AccessPattern. Each process gets its own
+// random stream and, without a page table, a 2^40-byte slice of the
+// physical address space (base()), so processes never share lines.
+class AccessStream {
+    const AccessPattern* pat = nullptr;
+    Rng rng{ 0, 0 };
+    uint64_t space = 0, pos = 0;
+    long long runLeft = 0; // Stride: accesses until the next jump
+
+public:
+    AccessStream() {}
+    AccessStream(const AccessPattern* p, uint64_t seed, uint64_t id) : pat(p), rng(Rng::forEntity(seed, id)), space(id << 40) {
+        if (p->kind == AccessPattern::Trace) pos = rng.next() % p->trace->size();
+    }
+
+    uint64_t base() const { return space; }
+
+    // Next virtual address.
+    uint64_t next() {
+        switch (pat->kind) {
+        case AccessPattern::Random: return (((rng.next() >> 32) * pat->ws) >> 32) & ~7ULL;
+        case AccessPattern::Trace: {
+            uint64_t a = (*pat->trace)[pos];
+            if (++pos == pat->trace->size()) pos = 0;
+            return a;
+        }
+        default:
+            if (runLeft-- == 0) {
+                // Geometric run length instead of a coin flip per access.
+                pos = ((rng.next() >> 32) * pat->ws) >> 32;
+                double u = 1.0 - rng.uniform01();
+                runLeft = pat->jump >= 1 ? 0 : pat->jump <= 0 ? LLONG_MAX : (long long)(std::log(u) / std::log1p(-pat->jump));
+            }
+            else if ((pos += pat->stride) >= pat->ws) pos -= pat->ws;
+            return pos;
+        }
+    }
+
+    // Runs n references through cache, untranslated; returns the hits.
+    long long run(SetAssocCache& cache, long long n) {
+        long long hits = 0;
+        for (long long i = 0; i < n; i++) hits += cache.access(space + next());
+        return hits;
+    }
+};
+
+/* =========================
+   VIRTUAL MEMORY
+   ========================= */
+// Physical memory size, page size and replacement policy of a headless run.
+struct MemoryConfig {
+    int frames = 0;        // physical page frames, 0: no memory model
+    int pageSize = 4096;   // bytes, a power of two
+    std::string policy = "lru"; // fifo, lru, clock, arc
+    BurstModel pageIn{ "uniform:10:10" }; // pager service time per fault
+    long long wsWindow = 2000; // working set: pages touched in the process's last wsWindow references
+    int wsInterval = 25;   // time units between reference bit samples
+    bool control = false;  // medium-term scheduler: suspend processes while working sets overcommit memory
+};
+
+// Per-process page table: a 4-level radix tree over 36-bit virtual page
+// numbers, 9 bits per level as on x86-64. Entries hold a node or frame index
+// + 1, 0 when absent. Nodes come from the table's own pool and are kept by
+// clear(), so a table reused for the next process in its row allocates
+// nothing.
+class PageTable {
+public:
+    static const int kLevels = 4, kBits = 9, kFanout = 1 << kBits;
+    static const uint64_t kVpnMask = (1ULL << (kLevels * kBits)) - 1;
+
+private:
+    std::vector<uint32_t> nodes; // kFanout entries per node, node 0 the root
+    uint32_t used = 0;
+
+    static size_t slot(uint32_t node, uint64_t vpn, int level) {
+        return (size_t)node * kFanout + ((vpn >> (level * kBits)) & (kFanout - 1));
+    }
+
+    template <typename F>
+    void walk(uint32_t node, int level, uint64_t prefix, F& fn) const {
+        for (int i = 0; i < kFanout; i++) {
+            uint32_t e = nodes[(size_t)node * kFanout + i];
+            if (!e) continue;
+            uint64_t vpn = (prefix << kBits) | (uint64_t)i;
+            if (level == 0) fn(vpn, e - 1);
+            else walk(e - 1, level - 1, vpn, fn);
+        }
+    }
+
+public:
+    // Frame holding vpn, or -1.
+    long long lookup(uint64_t vpn) const {
+        if (!used) return -1;
+        uint32_t n = 0;
+        for (int l = kLevels - 1; l > 0; l--) {
+            uint32_t e = nodes[slot(n, vpn, l)];
+            if (!e) return -1;
+            n = e - 1;
+        }
+        uint32_t e = nodes[slot(n, vpn, 0)];
+        return e ? (long long)e - 1 : -1;
+    }
+
+    void map(uint64_t vpn, uint32_t frame) {
+        if (!used) {
+            nodes.resize(std::max(nodes.size(), (size_t)kFanout), 0);
+            used = 1;
+        }
+        uint32_t n = 0;
+        for (int l = kLevels - 1; l > 0; l--) {
+            size_t i = slot(n, vpn, l);
+            if (!nodes[i]) {
+                if ((size_t)(used + 1) * kFanout > nodes.size()) nodes.resize((size_t)(used + 1) * kFanout, 0);
+                nodes[i] = ++used; // new node is used - 1, stored + 1
+            }
+            n = nodes[i] - 1;
+        }
+        nodes[slot(n, vpn, 0)] = frame + 1;
+    }
+
+    void unmap(uint64_t vpn) {
+        if (!used) return;
+        uint32_t n = 0;
+        for (int l = kLevels - 1; l > 0; l--) {
+            uint32_t e = nodes[slot(n, vpn, l)];
+            if (!e) return;
+            n = e - 1;
+        }
+        nodes[slot(n, vpn, 0)] = 0;
+    }
+
+    // Calls fn(vpn, frame) for every mapped page.
+    template <typename F>
+    void forEach(F fn) const {
+        if (used) walk(0, kLevels - 1, 0, fn);
+    }
+
+    void clear() {
+        std::fill(nodes.begin(), nodes.begin() + (size_t)used * kFanout, 0);
+        used = 0;
+    }
+
+    size_t bytes() const { return nodes.capacity() * sizeof(uint32_t); }
+};
+
+// Doubly linked lists threaded through shared prev/next arrays indexed by
+// frame (or ghost slot), so any element unlinks in O(1).
+class IndexLists {
+public:
+    enum : uint32_t { kNil = 0xffffffffu };
+    struct List {
+        uint32_t head = kNil, tail = kNil;
+        size_t size = 0;
+    };
+
+private:
+    std::vector<uint32_t> prev, next;
+
+public:
+    explicit IndexLists(size_t n) : prev(n, kNil), next(n, kNil) {}
+
+    void pushBack(List& l, uint32_t i) {
+        prev[i] = l.tail;
+        next[i] = kNil;
+        if (l.tail != kNil) next[l.tail] = i;
+        else l.head = i;
+        l.tail = i;
+        l.size++;
+    }
+
+    void unlink(List& l, uint32_t i) {
+        if (prev[i] != kNil) next[prev[i]] = next[i];
+        else l.head = next[i];
+        if (next[i] != kNil) prev[next[i]] = prev[i];
+        else l.tail = prev[i];
+        l.size--;
+    }
+};
+
+// Replacement policy over a fixed set of frames. On a fault with no free
+// frame the pool calls evict() with the incoming page's key, then loaded()
+// for the frame it fills; hits call touched(), and frames of exited
+// processes are handed back through freed().
+class PageReplacer {
+public:
+    virtual ~PageReplacer() {}
+    virtual uint32_t evict(uint64_t key) = 0;
+    virtual void loaded(uint32_t f, uint64_t key) = 0;
+    virtual void touched(uint32_t f) = 0;
+    virtual void freed(uint32_t f) = 0;
+};
+
+// FIFO evicts in load order; LRU moves a frame to the back on every hit.
+class ListReplacer : public PageReplacer {
+    IndexLists links;
+    IndexLists::List order; // front: next victim
+    bool lru;
+
+public:
+    ListReplacer(uint32_t frames, bool moveOnHit) : links(frames), lru(moveOnHit) {}
+
+    uint32_t evict(uint64_t) override {
+        uint32_t f = order.head;
+        links.unlink(order, f);
+        return f;
+    }
+    void loaded(uint32_t f, uint64_t) override { links.pushBack(order, f); }
+    void touched(uint32_t f) override {
+        if (!lru) return;
+        links.unlink(order, f);
+        links.pushBack(order, f);
+    }
+    void freed(uint32_t f) override { links.unlink(order, f); }
+};
+
+// Second chance: a hand sweeps the frames, clearing reference bits, and
+// evicts the first resident frame whose bit is already clear.
+class ClockReplacer : public PageReplacer {
+    std::vector<uint8_t> ref, resident;
+    uint32_t hand = 0;
+
+public:
+    explicit ClockReplacer(uint32_t frames) : ref(frames, 0), resident(frames, 0) {}
+
+    uint32_t evict(uint64_t) override {
+        while (true) {
+            uint32_t f = hand;
+            hand = hand + 1 == ref.size() ? 0 : hand + 1;
+            if (!resident[f]) continue;
+            if (ref[f]) { ref[f] = 0; continue; }
+            resident[f] = 0;
+            return f;
+        }
+    }
+    void loaded(uint32_t f, uint64_t) override { resident[f] = ref[f] = 1; }
+    void touched(uint32_t f) override { ref[f] = 1; }
+    void freed(uint32_t f) override { resident[f] = ref[f] = 0; }
+};
+
+// Adaptive Replacement Cache (Megiddo & Modha): resident pages seen once
+// (T1) or more (T2), plus ghost lists B1/B2 remembering the keys recently
+// evicted from each. A fault on a ghost shifts the target size p of T1
+// toward the list that would have kept it.
+class ArcReplacer : public PageReplacer {
+    uint32_t c;
+    double p = 0;
+    IndexLists frameLinks, ghostLinks;
+    IndexLists::List t1, t2, b1, b2;
+    std::vector<uint8_t> inT2;      // by frame
+    std::vector<uint64_t> frameKey; // by frame
+    std::vector<uint64_t> ghostKey; // by ghost slot
+    std::vector<uint8_t> ghostInB2; // by ghost slot
+    std::vector<uint32_t> freeGhosts;
+    std::unordered_map<uint64_t, uint32_t> ghostOf;
+    // Ghost lookup of the page being loaded, done once per fault.
+    bool pending = false, pendingHit = false, pendingInB2 = false;
+    uint64_t pendingKey = 0;
+
+    void adapt(uint64_t key) {
+        pending = true;
+        pendingKey = key;
+        auto it = ghostOf.find(key);
+        pendingHit = it != ghostOf.end();
+        pendingInB2 = false;
+        if (!pendingHit) return;
+        uint32_t g = it->second;
+        ghostOf.erase(it);
+        pendingInB2 = ghostInB2[g] != 0;
+        if (pendingInB2) {
+            p = std::max(0.0, p - std::max(1.0, (double)b1.size / b2.size));
+            ghostLinks.unlink(b2, g);
+        }
+        else {
+            p = std::min((double)c, p + std::max(1.0, (double)b2.size / b1.size));
+            ghostLinks.unlink(b1, g);
+        }
+        freeGhosts.push_back(g);
+    }
+
+    void dropGhost(IndexLists::List& l) {
+        uint32_t g = l.head;
+        ghostLinks.unlink(l, g);
+        ghostOf.erase(ghostKey[g]);
+        freeGhosts.push_back(g);
+    }
+
+public:
+    explicit ArcReplacer(uint32_t frames)
+        : c(frames), frameLinks(frames), ghostLinks(2 * (size_t)frames + 1), inT2(frames, 0), frameKey(frames, 0),
+          ghostKey(2 * (size_t)frames + 1, 0), ghostInB2(2 * (size_t)frames + 1, 0) {
+        for (uint32_t g = (uint32_t)ghostKey.size(); g-- > 0;) freeGhosts.push_back(g);
+    }
+
+    uint32_t evict(uint64_t key) override {
+        adapt(key);
+        bool fromT1 = t2.size == 0 || (t1.size > 0 && (t1.size > p || (pendingInB2 && t1.size == (size_t)p)));
+        IndexLists::List& from = fromT1 ? t1 : t2;
+        uint32_t f = from.head;
+        frameLinks.unlink(from, f);
+        uint32_t g = freeGhosts.back();
+        freeGhosts.pop_back();
+        ghostKey[g] = frameKey[f];
+        ghostInB2[g] = fromT1 ? 0 : 1;
+        ghostLinks.pushBack(fromT1 ? b1 : b2, g);
+        ghostOf[frameKey[f]] = g;
+        return f;
+    }
+
+    void loaded(uint32_t f, uint64_t key) override {
+        if (!pending || pendingKey != key) adapt(key);
+        pending = false;
+        frameKey[f] = key;
+        inT2[f] = pendingHit ? 1 : 0;
+        frameLinks.pushBack(pendingHit ? t2 : t1, f);
+        // Keep |T1| + |B1| <= c and all four lists within 2c.
+        while (t1.size + b1.size > c && b1.size > 0) dropGhost(b1);
+        while (t1.size + t2.size + b1.size + b2.size > 2 * (size_t)c) dropGhost(b2.size > 0 ? b2 : b1);
+    }
+
+    void touched(uint32_t f) override {
+        frameLinks.unlink(inT2[f] ? t2 : t1, f);
+        inT2[f] = 1;
+        frameLinks.pushBack(t2, f);
+    }
+
+    void freed(uint32_t f) override { frameLinks.unlink(inT2[f] ? t2 : t1, f); }
+};
+
+static std::unique_ptr<PageReplacer> makeReplacer(const std::string& kind, uint32_t frames) {
+    if (kind == "fifo") return std::unique_ptr<PageReplacer>(new ListReplacer(frames, false));
+    if (kind == "clock") return std::unique_ptr<PageReplacer>(new ClockReplacer(frames));
+    if (kind == "arc") return std::unique_ptr<PageReplacer>(new ArcReplacer(frames));
+    return std::unique_ptr<PageReplacer>(new ListReplacer(frames, true));
+}
+
+// Physical frames: who holds each one, a free list, and the replacement
+// policy choosing victims once memory is full.
+class FramePool {
+    std::vector<ProcHandle> owners;
+    std::vector<uint64_t> vpns;
+    std::vector<uint32_t> freeFrames;
+    std::unique_ptr<PageReplacer> repl;
+    std::vector<uint8_t> referenced; // reference bits, set by loads and hits
+    bool victimReferenced = false;
+
+public:
+    FramePool(uint32_t frames, const std::string& policy)
+        : owners(frames, kNoProc), vpns(frames, 0), repl(makeReplacer(policy, frames)), referenced(frames, 0) {
+        for (uint32_t f = frames; f-- > 0;) freeFrames.push_back(f);
+    }
+
+    // Frame for owner's page vpn (key identifies the page to the policy).
+    // If a resident page had to go, *evicted is its owner and *evictedVpn
+    // its page; otherwise *evicted is kNoProc.
+    uint32_t load(ProcHandle owner, uint64_t vpn, uint64_t key, ProcHandle* evicted, uint64_t* evictedVpn) {
+        uint32_t f;
+        *evicted = kNoProc;
+        if (!freeFrames.empty()) {
+            f = freeFrames.back();
+            freeFrames.pop_back();
+        }
+        else {
+            f = repl->evict(key);
+            *evicted = owners[f];
+            *evictedVpn = vpns[f];
+            victimReferenced = referenced[f] != 0;
+        }
+        owners[f] = owner;
+        vpns[f] = vpn;
+        referenced[f] = 1;
+        repl->loaded(f, key);
+        return f;
+    }
+
+    // Reference bit of the page evicted by the last load.
+    bool evictedReferenced() const { return victimReferenced; }
+
+    void touch(uint32_t f) {
+        referenced[f] = 1;
+        repl->touched(f);
+    }
+
+    bool testAndClearReferenced(uint32_t f) {
+        bool r = referenced[f] != 0;
+        referenced[f] = 0;
+        return r;
+    }
+
+    ProcHandle owner(uint32_t f) const { return owners[f]; }
+
+    void release(uint32_t f) {
+        repl->freed(f);
+        owners[f] = kNoProc;
+        freeFrames.push_back(f);
+    }
+
+    uint32_t frames() const { return (uint32_t)owners.size(); }
+    uint32_t freeCount() const { return (uint32_t)freeFrames.size(); }
+};
+
+/* =========================
+   KERNEL MEMORY
+   ========================= */
+// Simulated kernel allocators of the interactive simulator: frame count and
+// the largest per-process buffer, as an order (2^order frames).
+struct KmemConfig {
+    int frames = 0;   // 0: no kernel memory model
+    int maxOrder = 3; // per-process buffers of 2^0..2^maxOrder frames
+};
+
+// Binary buddy allocator over frames [0, frames). Free blocks of each order
+// sit on their own list, and a bitmap per order says whether the block at an
+// index is free at that order, so a buddy is found in O(1) and a split or
+// coalesce walks at most kMaxOrder levels.
+class BuddyAllocator {
+public:
+    static const int kMaxOrder = 10; // blocks of up to 1024 frames
+
+private:
+    uint32_t total, freeFrames = 0;
+    IndexLists links; // by block head frame
+    IndexLists::List lists[kMaxOrder + 1];
+    std::vector<uint64_t> freeBits[kMaxOrder + 1];
+
+    bool isFree(int order, uint32_t f) const {
+        uint32_t i = f >> order;
+        return (freeBits[order][i >> 6] >> (i & 63)) & 1;
+    }
+    void setFree(int order, uint32_t f, bool on) {
+        uint32_t i = f >> order;
+        if (on) freeBits[order][i >> 6] |= 1ULL << (i & 63);
+        else freeBits[order][i >> 6] &= ~(1ULL << (i & 63));
+    }
+    void push(int order, uint32_t f) {
+        links.pushBack(lists[order], f);
+        setFree(order, f, true);
+    }
+    void remove(int order, uint32_t f) {
+        links.unlink(lists[order], f);
+        setFree(order, f, false);
+    }
+
+public:
+    explicit BuddyAllocator(uint32_t frames) : total(frames), links(frames) {
+        for (int o = 0; o <= kMaxOrder; o++) freeBits[o].assign(((frames >> o) >> 6) + 1, 0);
+        // Carve the frames into the largest aligned blocks that fit.
+        for (uint32_t f = 0; f < frames;) {
+            int o = kMaxOrder;
+            while (o > 0 && ((f & ((1u << o) - 1)) != 0 || f + (1u << o) > frames)) o--;
+            push(o, f);
+            freeFrames += 1u << o;
+            f += 1u << o;
+        }
+    }
+
+    // First frame of a free 2^order block, or -1 if none is left.
+    long long alloc(int order) {
+        int o = order;
+        while (o <= kMaxOrder && lists[o].size == 0) o++;
+        if (o > kMaxOrder) return -1;
+        uint32_t f = lists[o].head;
+        remove(o, f);
+        // Split down, freeing the upper half at each level.
+        while (o > order) {
+            o--;
+            push(o, f + (1u << o));
+        }
+        freeFrames -= 1u << order;
+        return f;
+    }
+
+    // Returns a block from alloc(order), merging it with free buddies.
+    void free(uint32_t f, int order) {
+        freeFrames += 1u << order;
+        for (; order < kMaxOrder; order++) {
+            uint32_t buddy = f ^ (1u << order);
+            if (buddy + (1u << order) > total || !isFree(order, buddy)) break;
+            remove(order, buddy);
+            f &= ~(1u << order);
+        }
+        push(order, f);
+    }
+
+    uint32_t frames() const { return total; }
+    uint32_t freeCount() const { return freeFrames; }
+    size_t freeBlocks(int order) const { return lists[order].size; }
+
+    int largestFreeOrder() const {
+        for (int o = kMaxOrder; o >= 0; o--)
+            if (lists[o].size) return o;
+        return -1;
+    }
+
+    // Share of free memory in blocks too small for an allocation of this
+    // order (Gorman's unusable free space index): 0 unfragmented, 1 when no
+    // request of that order can succeed.
+    double unusableIndex(int order) const {
+        if (freeFrames == 0) return 0;
+        uint64_t usable = 0;
+        for (int o = order; o <= kMaxOrder; o++) usable += (uint64_t)lists[o].size << o;
+        return 1 - (double)usable / freeFrames;
+    }
+};
+
+// Fixed-size objects carved from buddy blocks of 2^order frames (slabs).
+// Slabs are aligned, so an object's slab is its frame >> order, and each
+// slab keeps a free list of object indices. Slabs move between the partial,
+// full and empty lists; one empty slab is kept for reuse and the rest go
+// back to the buddy allocator.
+class SlabCache {
+    BuddyAllocator* buddy;
+    uint32_t objSize, pageSize, perSlab;
+    int order;
+    IndexLists links; // by slab
+    IndexLists::List partial, full, empty;
+    std::vector<uint32_t> inUse, freeHead; // by slab
+    std::vector<uint32_t> next;            // by slab x perSlab: free list links
+    uint32_t slabs = 0;
+    uint64_t live = 0;
+
+    enum : uint32_t { kNil = 0xffffffffu };
+
+public:
+    static const uint64_t kNoAddr = ~0ULL;
+
+    // Slabs are the smallest order holding at least 8 objects.
+    SlabCache(BuddyAllocator* b, uint32_t objectBytes, uint32_t pageBytes)
+        : buddy(b), objSize(objectBytes), pageSize(pageBytes), order(0), links(0) {
+        while (order < BuddyAllocator::kMaxOrder && ((uint64_t)pageSize << order) / objSize < 8) order++;
+        perSlab = (uint32_t)(((uint64_t)pageSize << order) / objSize);
+        uint32_t maxSlabs = (b->frames() >> order) + 1;
+        links = IndexLists(maxSlabs);
+        inUse.assign(maxSlabs, 0);
+        freeHead.assign(maxSlabs, kNil);
+        next.assign((size_t)maxSlabs * perSlab, kNil);
+    }
+
+    // Byte address of a free object, or kNoAddr when memory is exhausted.
+    uint64_t alloc() {
+        uint32_t s;
+        if (partial.size) s = partial.head;
+        else if (empty.size) {
+            s = empty.head;
+            links.unlink(empty, s);
+            links.pushBack(partial, s);
+        }
+        else {
+            long long f = buddy->alloc(order);
+            if (f < 0) return kNoAddr;
+            s = (uint32_t)f >> order;
+            uint32_t* nx = &next[(size_t)s * perSlab];
+            for (uint32_t i = 0; i + 1 < perSlab; i++) nx[i] = i + 1;
+            nx[perSlab - 1] = kNil;
+            freeHead[s] = 0;
+            inUse[s] = 0;
+            slabs++;
+            links.pushBack(partial, s);
+        }
+        uint32_t i = freeHead[s];
+        freeHead[s] = next[(size_t)s * perSlab + i];
+        if (++inUse[s] == perSlab) {
+            links.unlink(partial, s);
+            links.pushBack(full, s);
+        }
+        live++;
+        return ((uint64_t)s << order) * pageSize + (uint64_t)i * objSize;
+    }
+
+    void free(uint64_t addr) {
+        uint64_t slabBytes = (uint64_t)pageSize << order;
+        uint32_t s = (uint32_t)(addr / slabBytes);
+        uint32_t i = (uint32_t)((addr % slabBytes) / objSize);
+        next[(size_t)s * perSlab + i] = freeHead[s];
+        freeHead[s] = i;
+        live--;
+        if (inUse[s]-- == perSlab) {
+            links.unlink(full, s);
+            links.pushBack(partial, s);
+        }
+        if (inUse[s] == 0) {
+            links.unlink(partial, s);
+            if (empty.size == 0) links.pushBack(empty, s);
+            else {
+                buddy->free(s << order, order);
+                slabs--;
+            }
+        }
+    }
+
+    uint64_t objects() const { return live; }
+    uint32_t slabCount() const { return slabs; }
+    uint32_t objectsPerSlab() const { return perSlab; }
+    int slabOrder() const { return order; }
+
+    // Share of slab memory holding live objects.
+    double utilization() const {
+        return slabs ? (double)(live * objSize) / ((double)slabs * ((uint64_t)pageSize << order)) : 0;
+    }
+};
+
+// Kernel memory of the interactive simulator, shared by producerThread and
+// cpuThread: each process gets a PCB from a slab cache, a 2-frame kernel
+// stack and a buffer of random order from the buddy allocator, all freed
+// when it leaves.
+class KernelMemory {
+public:
+    static const int kPageSize = 4096;
+
+private:
+    struct Held {
+        uint64_t pcb;
+        uint32_t stack, buffer;
+        int bufferOrder;
+    };
+    SimMutex mtx{ "KernelMemory::mtx" };
+    BuddyAllocator buddy;
+    SlabCache pcbs;
+    Rng rng;
+    int maxOrder;
+    std::vector<Held> held; // by table row
+    long long failures = 0;
+
+public:
+    KernelMemory(const KmemConfig& cfg, uint32_t pcbBytes, uint64_t seed)
+        : buddy((uint32_t)cfg.frames), pcbs(&buddy, pcbBytes, kPageSize), rng(seed, kStreamKmem),
+          maxOrder(cfg.maxOrder) {}
+
+    // Allocates everything a new process in table row `row` holds. False,
+    // with nothing held, once memory is exhausted.
+    bool allocFor(uint32_t row) {
+        std::lock_guard<SimMutex> lock(mtx);
+        Held h;
+        h.bufferOrder = rng.uniformInt(0, maxOrder);
+        h.pcb = pcbs.alloc();
+        long long stack = h.pcb == SlabCache::kNoAddr ? -1 : buddy.alloc(1);
+        long long buffer = stack < 0 ? -1 : buddy.alloc(h.bufferOrder);
+        if (buffer < 0) {
+            if (stack >= 0) buddy.free((uint32_t)stack, 1);
+            if (h.pcb != SlabCache::kNoAddr) pcbs.free(h.pcb);
+            failures++;
+            return false;
+        }
+        h.stack = (uint32_t)stack;
+        h.buffer = (uint32_t)buffer;
+        if (row >= held.size()) held.resize(row + 1);
+        held[row] = h;
+        return true;
+    }
+
+    void freeFor(uint32_t row) {
+        std::lock_guard<SimMutex> lock(mtx);
+        const Held& h = held[row];
+        buddy.free(h.buffer, h.bufferOrder);
+        buddy.free(h.stack, 1);
+        pcbs.free(h.pcb);
+    }
+
+    void report(std::ostream& os) {
+        std::lock_guard<SimMutex> lock(mtx);
+        os << "Kernel memory: " << buddy.freeCount() << " of " << buddy.frames() << " frames free, largest free block order "
+           << buddy.largestFreeOrder() << ", " << failures << " failed allocations\n";
+        os << "  free blocks by order:";
+        for (int o = 0; o <= BuddyAllocator::kMaxOrder; o++) os << " " << buddy.freeBlocks(o);
+        os << "\n  unusable free space: order " << maxOrder << " " << buddy.unusableIndex(maxOrder) << ", order "
+           << BuddyAllocator::kMaxOrder << " " << buddy.unusableIndex(BuddyAllocator::kMaxOrder) << "\n";
+        os << "  PCB slab cache: " << pcbs.objects() << " objects in " << pcbs.slabCount() << " slabs of order "
+           << pcbs.slabOrder() << " (" << pcbs.objectsPerSlab() << " each), utilization " << pcbs.utilization() << "\n";
+    }
+};
+
+/* =========================
+   LATENCY HISTOGRAMS
+   ========================= */
+// High-dynamic-range histogram: values below 2^kSubBits are exact; above
+// that each power-of-two range is split into 2^(kSubBits-1) linear buckets,
+// so any recorded value is reported within 1/128 of its true value.
+class HdrHistogram {
+public:
+    static const int kSubBits = 8;
+    static const int kBuckets = (1 << kSubBits) + (64 - kSubBits) * (1 << (kSubBits - 1));
+
+    static int bucketOf(uint64_t v) {
+        if (v < (1ULL << kSubBits)) return (int)v;
+        int e = (63 - __builtin_clzll(v)) - kSubBits + 1;
+        return (1 << kSubBits) + (e - 1) * (1 << (kSubBits - 1)) + (int)((v >> e) - (1ULL << (kSubBits - 1)));
+    }
+
+    // Largest value that maps to bucket b.
+    static uint64_t bucketHigh(int b) {
+        if (b < (1 << kSubBits)) return (uint64_t)b;
+        int r = b - (1 << kSubBits);
+        int e = r / (1 << (kSubBits - 1)) + 1;
+        uint64_t m = (uint64_t)(r % (1 << (kSubBits - 1))) + (1ULL << (kSubBits - 1));
+        return ((m + 1) << e) - 1;
+    }
+
+    HdrHistogram() : counts(kBuckets, 0) {}
+
+    void record(uint64_t v) {
+        counts[bucketOf(v)]++;
+        total++;
+        maxV = std::max(maxV, v);
+    }
+
+    void addBucket(int b, uint64_t n) { counts[b] += n; total += n; }
+    void noteMax(uint64_t v) { maxV = std::max(maxV, v); }
+
+    void merge(const HdrHistogram& o) {
+        for (int b = 0; b < kBuckets; b++) counts[b] += o.counts[b];
+        total += o.total;
+        maxV = std::max(maxV, o.maxV);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxV; }
+
+    uint64_t percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)std::ceil(q / 100.0 * total), seen = 0;
+        if (rank == 0) rank = 1;
+        for (int b = 0; b < kBuckets; b++) {
+            seen += counts[b];
+            if (seen >= rank) return std::min(bucketHigh(b), maxV);
+        }
+        return maxV;
+    }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0, maxV = 0;
+};
+
+enum LatencyMetric { kLatBufferWait, kLatResourceWait, kLatDispatch, kLatResume, kLatKmemAlloc, kLatencyMetrics };
+
+static const char* latencyName(int m) {
+    static const char* names[kLatencyMetrics] = { "buffer wait", "resource wait", "dispatch", "resume", "kmem alloc" };
+    return names[m];
+}
+
+// Host-time latencies recorded into per-thread shards (single writer, so a
+// relaxed load/store instead of a locked add) and merged when read.
+class LatencyRecorder {
+private:
+    struct Shard {
+        std::atomic<uint64_t> counts[kLatencyMetrics][HdrHistogram::kBuckets];
+        std::atomic<uint64_t> maxV[kLatencyMetrics];
+        Shard() {
+            for (auto& row : counts) for (auto& c : row) c.store(0, std::memory_order_relaxed);
+            for (auto& m : maxV) m.store(0, std::memory_order_relaxed);
+        }
+    };
+    std::mutex regMtx;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard* local() {
+        static thread_local Shard* shard = nullptr;
+        if (!shard) {
+            std::lock_guard<std::mutex> lock(regMtx);
+            shards.emplace_back(new Shard());
+            shard = shards.back().get();
+        }
+        return shard;
+    }
+
+public:
+    void record(LatencyMetric m, long long ns) {
+        uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+        Shard* s = local();
+        std::atomic<uint64_t>& c = s->counts[m][HdrHistogram::bucketOf(v)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (v > s->maxV[m].load(std::memory_order_relaxed)) s->maxV[m].store(v, std::memory_order_relaxed);
+    }
+
+    HdrHistogram merged(LatencyMetric m) {
+        HdrHistogram h;
+        std::lock_guard<std::mutex> lock(regMtx);
+        for (auto& s : shards) {
+            for (int b = 0; b < HdrHistogram::kBuckets; b++) {
+                uint64_t n = s->counts[m][b].load(std::memory_order_relaxed);
+                if (n) h.addBucket(b, n);
+            }
+            h.noteMax(s->maxV[m].load(std::memory_order_relaxed));
+        }
+        return h;
+    }
+
+    void report(std::ostream& os) {
+        os << std::left << std::setw(16) << "latency (us)" << std::right << std::setw(10) << "count"
+           << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p999" << std::setw(10) << "max" << "\n";
+        os << std::fixed << std::setprecision(1);
+        for (int m = 0; m < kLatencyMetrics; m++) {
+            HdrHistogram h = merged((LatencyMetric)m);
+            os << std::left << std::setw(16) << latencyName(m) << std::right << std::setw(10) << h.count()
+               << std::setw(10) << h.percentile(50) / 1e3 << std::setw(10) << h.percentile(99) / 1e3
+               << std::setw(10) << h.percentile(99.9) / 1e3 << std::setw(10) << h.max() / 1e3 << "\n";
+        }
+        os.unsetf(std::ios::floatfield);
+        os << std::setprecision(6);
+    }
+};
+
+static LatencyRecorder gLatency;
+
+static long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* =========================
+   RUN CONTROL
+   ========================= */
+// Run/pause/stop state for the simulation threads. Paused threads park on a
+// condition variable and are released as soon as the menu changes the state;
+// resume latency (Run to thread awake) goes to the "resume" histogram.
+class RunGate {
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    std::atomic<bool> running{ false }, stopping{ false }, draining{ false }, inputClosed{ false };
+    bool drained = false;    // guarded by m
+    long long resumedNs = 0; // guarded by m
+
+public:
+    bool isRunning() const { return running.load(std::memory_order_relaxed); }
+    bool isStopping() const { return stopping.load(std::memory_order_relaxed); }
+    bool isDraining() const { return draining.load(std::memory_order_relaxed); }
+    bool isInputClosed() const { return inputClosed.load(std::memory_order_acquire); }
+
+    void run() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            running = true;
+            resumedNs = nowNs();
+        }
+        cv.notify_all();
+    }
+
+    void pause() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            running = false;
+        }
+        cv.notify_all();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+    }
+
+    // Graceful exit: the producer stops; once it has exited, closeInput()
+    // lets consumers finish queued work and call markDrained(). Resumes a
+    // paused simulation.
+    void drain() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            draining = true;
+            running = true;
+        }
+        cv.notify_all();
+    }
+
+    void closeInput() { inputClosed.store(true, std::memory_order_release); }
+
+    void markDrained() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            drained = true;
+        }
+        cv.notify_all();
+    }
+
+    bool waitDrained(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(m);
+        return cv.wait_until(lock, deadline, [this] { return drained; });
+    }
+
+    // Parks while paused; false once stopped.
+    bool waitRunnable() {
+        if (isRunning() && !isStopping()) return true;
+        std::unique_lock<std::mutex> lock(m);
+        bool parked = false;
+        while (!running && !stopping) {
+            parked = true;
+            cv.wait(lock);
+        }
+        if (parked && !stopping) gLatency.record(kLatResume, nowNs() - resumedNs);
+        return !stopping;
+    }
+
+    // Sleeps until deadline, waking at once on stop or drain; false once stopped.
+    bool sleepUntil(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(m);
+        bool wasDraining = draining;
+        while (!stopping && draining == wasDraining) {
+            if (cv.wait_until(lock, deadline) == std::cv_status::timeout) break;
+        }
+        return !stopping;
+    }
+};
+
+static RunGate gGate;
+
+/* =========================
+   TRACE EXPORT
+   ========================= */
+// Chrome trace-event JSON, written incrementally through a large stdio buffer
+// so long runs stream to disk; opens in Perfetto or chrome://tracing.
+// Track layout: pid 1 holds one thread per simulated CPU (simulated time, one
+// time unit shown as 1 us), pid 2 holds the host threads (wall-clock us).
+class TraceWriter {
+private:
+    FILE* f = nullptr;
+    bool first = true;
+    long long baseNs = 0;
+    std::vector<char> iobuf;
+    std::mutex mtx;
+
+    void emit(const char* fmt, ...) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!f) return;
+        std::fputs(first ? "\n" : ",\n", f);
+        first = false;
+        va_list ap;
+        va_start(ap, fmt);
+        std::vfprintf(f, fmt, ap);
+        va_end(ap);
+    }
+
+public:
+    enum { kSimPid = 1, kHostPid = 2 };
+    enum { kHostMain = 0, kHostProducer = 1, kHostCpu = 2 };
+
+    ~TraceWriter() { close(); }
+
+    bool open(const std::string& path) {
+        f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        iobuf.resize(1 << 20);
+        std::setvbuf(f, iobuf.data(), _IOFBF, iobuf.size());
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", f);
+        baseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!f) return;
+        std::fputs("\n]}\n", f);
+        std::fclose(f);
+        f = nullptr;
+    }
+
+    bool isOpen() const { return f != nullptr; }
+
+    // Wall-clock microseconds since open(), for host-thread tracks.
+    long long hostUs() const {
+        return (std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count() - baseNs) / 1000;
+    }
+
+    void processName(int pid, const char* name) {
+        emit("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}}", pid, name);
+    }
+
+    void threadName(int pid, int tid, const char* name) {
+        emit("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid, tid, name);
+    }
+
+    // A process slice or any other span with known duration.
+    void complete(int pid, int tid, const char* cat, const char* name, int procId, long long ts, long long dur) {
+        emit("{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s P%d\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"args\":{\"pid\":%d}}",
+             cat, name, procId, pid, tid, ts, dur, procId);
+    }
+
+    // Async span per simulated process (ph 'b' or 'e'), e.g. time in buffer.
+    void async(char ph, const char* cat, int procId, long long ts) {
+        emit("{\"ph\":\"%c\",\"cat\":\"%s\",\"name\":\"%s\",\"id\":%d,\"pid\":%d,\"tid\":0,\"ts\":%lld}",
+             ph, cat, cat, procId, (int)kSimPid, ts);
+    }
+
+    // Flow arrow between host threads (ph 's' start, 'f' finish) for a handoff.
+    void flow(char ph, int tid, int procId, long long ts) {
+        emit("{\"ph\":\"%c\",\"cat\":\"handoff\",\"name\":\"buffer\",\"id\":%d,\"pid\":%d,\"tid\":%d,\"ts\":%lld%s}",
+             ph, procId, (int)kHostPid, tid, ts, ph == 'f' ? ",\"bp\":\"e\"" : "");
+    }
+
+    void instant(int tid, const char* name, int procId, long long ts) {
+        emit("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s P%d\",\"pid\":%d,\"tid\":%d,\"ts\":%lld}",
+             name, procId, (int)kHostPid, tid, ts);
+    }
+};
+
+/* =========================
+   BOUNDED BUFFER
+   ========================= */
+class BoundedBuffer {
+private:
+    std::vector<ProcHandle> buf;
+    int cap, head = 0, tail = 0;
+    sem_t empty, full;
+    SimMutex mtx{ "BoundedBuffer::mtx" };
+
+public:
+    explicit BoundedBuffer(int c) : buf(c, kNoProc), cap(c) {
+        sem_init(&empty, 0, c);
+        sem_init(&full, 0, 0);
+    }
+    ~BoundedBuffer() {
+        sem_destroy(&empty);
+        sem_destroy(&full);
+    }
+
+    // Blocks while full; false (p not taken) if the simulation stops or
+    // starts draining first.
+    bool push(ProcHandle p) {
+        while (sem_trywait(&empty) != 0) {
+            if (gGate.isStopping() || gGate.isDraining()) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        {
+            std::lock_guard<SimMutex> lock(mtx);
+            buf[tail] = p;
+            tail = (tail + 1) % cap;
+        }
+        sem_post(&full);
+        return true;
+    }
+
+    // Non-blocking variants for single-threaded (headless) use.
+    bool tryPush(ProcHandle p) {
+        if (sem_trywait(&empty) != 0) return false;
+        {
+            std::lock_guard<SimMutex> lock(mtx);
+            buf[tail] = p;
+            tail = (tail + 1) % cap;
+        }
+        sem_post(&full);
+        return true;
+    }
+
+    ProcHandle tryPop() {
+        if (sem_trywait(&full) != 0) return kNoProc;
+        ProcHandle p;
+        {
+            std::lock_guard<SimMutex> lock(mtx);
+            p = buf[head];
+            buf[head] = kNoProc;
+            head = (head + 1) % cap;
+        }
+        sem_post(&empty);
+        return p;
+    }
+
+    int size() {
+        int val;
+        sem_getvalue(&full, &val);
+        return std::max(0, val);
+    }
+
+    ProcHandle pop() {
+        // Non-blocking check for stop signal
+        int val;
+        sem_getvalue(&full, &val);
+        if (val <= 0 && (gGate.isStopping() || gGate.isInputClosed())) return kNoProc;
+
+        // Using a simple wait logic to avoid sem_timedwait portability issues
+        while (true) {
+            if (sem_trywait(&full) == 0) break;
+            if (gGate.isStopping() || gGate.isInputClosed()) return kNoProc;
+            if (!gGate.isRunning()) {
+                // Park instead of polling while the simulation is paused.
+                if (!gGate.waitRunnable()) return kNoProc;
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        ProcHandle p;
+        {
+            std::lock_guard<SimMutex> lock(mtx);
+            p = buf[head];
+            buf[head] = kNoProc;
+            head = (head + 1) % cap;
+        }
+        sem_post(&empty);
+        return p;
+    }
+};
+
+/* =========================
+   RESOURCE MANAGER
+   ========================= */
+class ResourceManager {
+private:
+    std::vector<int> available;
+    ProcessTable* table; // a grant is the row's demand plus kProcHoldsResources
+    SimMutex mtx{ "ResourceManager::mtx" };
+
+public:
+    ResourceManager(const std::vector<int>& avail, ProcessTable* t) : available(avail), table(t) {}
+
+    bool requestResources(ProcHandle p) {
+        const uint16_t* demand = table->demand(p);
+        std::lock_guard<SimMutex> lock(mtx);
+        for (size_t i = 0; i < available.size(); i++) {
+            if (demand[i] > available[i]) return false;
+        }
+        for (size_t i = 0; i < available.size(); i++) {
+            available[i] -= demand[i];
+        }
+        table->flags(p) |= kProcHoldsResources;
+        return true;
+    }
+
+    void releaseAll(ProcHandle p) {
+        if (!table->valid(p)) return;
+        std::lock_guard<SimMutex> lock(mtx);
+        uint8_t& flags = table->flags(p);
+        if (flags & kProcHoldsResources) {
+            const uint16_t* demand = table->demand(p);
+            for (size_t i = 0; i < available.size(); i++)
+                available[i] += demand[i];
+            flags &= (uint8_t)~kProcHoldsResources;
+        }
+    }
+
+    std::vector<int> getAvailable() {
+        std::lock_guard<SimMutex> lock(mtx);
+        return available;
+    }
+};
+
+/* =========================
+   SCHEDULER
+   ========================= */
+enum class SchedPolicy { RoundRobin, Fcfs, Sjf };
+
+static const char* policyName(SchedPolicy p) {
+    switch (p) {
+    case SchedPolicy::Fcfs: return "fcfs";
+    case SchedPolicy::Sjf: return "sjf";
+    default: return "rr";
+    }
+}
+
+static bool parsePolicy(const std::string& s, SchedPolicy& out) {
+    if (s == "rr") out = SchedPolicy::RoundRobin;
+    else if (s == "fcfs") out = SchedPolicy::Fcfs;
+    else if (s == "sjf") out = SchedPolicy::Sjf;
+    else return false;
+    return true;
+}
+
+// Price of switching a CPU to a different process, in time units: a fixed
+// overhead plus a cache refill penalty. The penalty is full on a process's
+// first slice or after it moved CPUs, and otherwise scales with the work the
+// CPU ran for others since, reaching full after `decay` units (0: any).
+struct SwitchCost {
+    int overhead = 0, coldPenalty = 0, decay = 0;
+};
+
+class Scheduler {
+private:
+    struct Core {
+        ProcHandle last = kNoProc; // process of the previous slice
+        long long work = 0;        // units run so far, switch costs included
+    };
+
+    int quantum, time = 0;
+    SchedPolicy policy;
+    ProcessTable* table;
+    SwitchCost sw;
+    std::vector<Core> cores;
+    long long switches = 0, switchTime = 0;
+    std::deque<ProcHandle> ready;
+    std::atomic<int> depth{ 0 }; // ready.size(), readable without mtx
+    std::vector<std::pair<int, int>> gantt;
+    TraceWriter* trace = nullptr;
+    SimMutex mtx{ "Scheduler::mtx" };
+
+    // Caller holds mtx. Switch overhead plus cache refill for running p on
+    // cpu next; advances the CPU's work clock past the coming slice.
+    int switchLocked(ProcHandle p, int cpu, int slice) {
+        Core& core = cores[cpu];
+        int cost = 0;
+        if (core.last != p) {
+            int cold = sw.coldPenalty;
+            if (table->lastCpu(p) == cpu) {
+                long long since = core.work - table->lastRan(p);
+                if (sw.decay > 0 && since < sw.decay) cold = (int)((cold * since + sw.decay - 1) / sw.decay);
+                else if (since == 0) cold = 0;
+            }
+            cost = sw.overhead + cold;
+            switches++;
+            switchTime += cost;
+        }
+        core.last = p;
+        core.work += cost + slice;
+        table->lastCpu(p) = (int16_t)cpu;
+        table->lastRan(p) = core.work;
+        return cost;
+    }
+
+    // Caller holds mtx. Removes the next process per policy and sets the
+    // length of its next slice (a full quantum at most under round robin).
+    ProcHandle pickLocked(int& slice) {
+        if (ready.empty()) return kNoProc;
+        auto it = ready.begin();
+        if (policy == SchedPolicy::Sjf) {
+            ProcessTable* t = table;
+            it = std::min_element(ready.begin(), ready.end(),
+                [t](ProcHandle a, ProcHandle b) { return t->remaining(a) < t->remaining(b); });
+        }
+        ProcHandle p = *it;
+        ready.erase(it);
+        depth.store((int)ready.size(), std::memory_order_relaxed);
+        table->state(p) = ProcState::Running;
+        int remaining = table->remaining(p);
+        slice = policy == SchedPolicy::RoundRobin ? std::min(quantum, remaining) : remaining;
+        return p;
+    }
+
+public:
+    Scheduler(int q, SchedPolicy pol, ProcessTable* t, int cpus = 1, SwitchCost cost = SwitchCost())
+        : quantum(q), policy(pol), table(t), sw(cost), cores(cpus) {}
+
+    void addReady(ProcHandle p) {
+        std::lock_guard<SimMutex> lock(mtx);
+        table->state(p) = ProcState::Ready;
+        ready.push_back(p);
+        depth.store((int)ready.size(), std::memory_order_relaxed);
+    }
+
+    // Takes p out of scheduling until addReady, while it waits on I/O or a
+    // page fault.
+    void block(ProcHandle p) {
+        std::lock_guard<SimMutex> lock(mtx);
+        table->state(p) = ProcState::Blocked;
+    }
+
+    // Emits each dispatch() slice on simulated CPU 0.
+    void setTrace(TraceWriter* t) { trace = t; }
+
+    int readyCount() {
+        return depth.load(std::memory_order_relaxed);
+    }
+
+    ProcHandle dispatch() {
+        std::lock_guard<SimMutex> lock(mtx);
+        int slice;
+        ProcHandle p = pickLocked(slice);
+        if (p == kNoProc) return kNoProc;
+
+        int pid = table->pid(p);
+        int cost = switchLocked(p, 0, slice);
+        if (cost > 0) {
+            gantt.push_back({ -1, cost });
+            if (trace) trace->complete(TraceWriter::kSimPid, 0, "cpu", "switch", pid, time, cost);
+            time += cost;
+        }
+        table->remaining(p) -= slice;
+        gantt.push_back({ pid, slice });
+        if (trace) trace->complete(TraceWriter::kSimPid, 0, "cpu", "run", pid, time, slice);
+        time += slice;
+
+        if (table->remaining(p) > 0) {
+            table->state(p) = ProcState::Ready;
+            ready.push_back(p);
+            depth.store((int)ready.size(), std::memory_order_relaxed);
+            return kNoProc;
+        }
+        table->state(p) = ProcState::Terminated;
+        return p;
+    }
+
+    // Event-driven dispatch for the headless engine: the caller spends cost
+    // switching to the process on cpu, runs the slice, then re-queues the
+    // process with addReady or retires it.
+    ProcHandle take(int cpu, int& slice, int& cost) {
+        std::lock_guard<SimMutex> lock(mtx);
+        ProcHandle p = pickLocked(slice);
+        if (p != kNoProc) cost = switchLocked(p, cpu, slice);
+        return p;
+    }
+
+    // Context switches so far and the time they cost.
+    long long switchCount() {
+        std::lock_guard<SimMutex> lock(mtx);
+        return switches;
+    }
+    long long switchCost() {
+        std::lock_guard<SimMutex> lock(mtx);
+        return switchTime;
+    }
+
+    // Empties the ready queue, for reclaiming at shutdown.
+    std::vector<ProcHandle> takeAll() {
+        std::lock_guard<SimMutex> lock(mtx);
+        std::vector<ProcHandle> all(ready.begin(), ready.end());
+        ready.clear();
+        depth.store(0, std::memory_order_relaxed);
+        return all;
+    }
+
+    void printGantt() {
+        std::lock_guard<SimMutex> lock(mtx);
+        if (gantt.empty()) { std::cout << "\nGantt chart is empty.\n"; return; }
+        std::cout << "\n=== GANTT CHART ===\n|";
+        for (auto& g : gantt) {
+            if (g.first < 0) std::cout << " CS |";
+            else std::cout << " P" << g.first << " |";
+        }
+        std::cout << "\n0";
+        int t = 0;
+        for (auto& g : gantt) { t += g.second; std::cout << std::setw(5) << t; }
+        std::cout << "\n";
+    }
+};
+
+/* =========================
+   EVENT LIST
+   ========================= */
+// Future-event list of the headless engine. T needs a long long time and
+// operator> ordering by (time, seq); every list pops in exactly that order,
+// so the choice of list never changes results. Times pushed must not precede
+// the last popped time.
+template <typename T>
+class EventList {
+public:
+    virtual ~EventList() {}
+    virtual void push(const T& e) = 0;
+    virtual const T& top() = 0; // earliest event; the list must not be empty
+    virtual void pop() = 0;
+    virtual size_t size() const = 0;
+    bool empty() const { return size() == 0; }
+};
+
+template <typename T>
+class HeapEventList : public EventList<T> {
+    std::priority_queue<T, std::vector<T>, std::greater<T>> heap;
+
+public:
+    void push(const T& e) override { heap.push(e); }
+    const T& top() override { return heap.top(); }
+    void pop() override { heap.pop(); }
+    size_t size() const override { return heap.size(); }
+};
+
+// Hierarchical timing wheel (Varghese & Lauck): kLevels wheels of kSlots
+// slots, level k holding timers that differ from the current time first in
+// digit k. Insert and cancel are O(1); a slot is cascaded one level down when
+// time reaches it, and timers beyond the top level wait in an overflow list.
+// Nodes live in a pool and are addressed by generation-checked TimerIds.
+template <typename T>
+class TimingWheel : public EventList<T> {
+public:
+    typedef uint64_t TimerId;
+
+private:
+    static const int kLevels = 4, kBits = 8, kSlots = 1 << kBits;
+    static const uint32_t kNil = 0xffffffffu;
+    enum : int8_t { kInReady = -1, kInOverflow = -2, kFree = -3 };
+    struct Node {
+        T item;
+        uint32_t prev, next;
+        uint32_t gen;
+        int8_t level; // wheel level, or kInReady / kInOverflow / kFree
+        uint8_t slot;
+        bool live;    // false once cancelled
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t head[kLevels][kSlots];
+    uint64_t occupied[kLevels][kSlots / 64];
+    std::vector<uint32_t> ready;    // timers due at readyTime, in (time, seq) order
+    size_t readyPos = 0;
+    bool haveReady = false;
+    long long readyTime = 0;
+    long long cur = 0;              // placement reference: no pending timer is earlier
+    typedef std::pair<long long, uint32_t> Deferred; // (time, node) beyond the top level
+    std::priority_queue<Deferred, std::vector<Deferred>, std::greater<Deferred>> overflow;
+    size_t live = 0;
+
+    uint32_t allocNode(const T& e) {
+        uint32_t i;
+        if (!freeNodes.empty()) {
+            i = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[i].item = e;
+        }
+        else {
+            i = (uint32_t)nodes.size();
+            nodes.push_back(Node{ e, kNil, kNil, 0, kFree, 0, false });
+        }
+        nodes[i].live = true;
+        return i;
+    }
+
+    void freeNode(uint32_t i) {
+        nodes[i].gen++;
+        nodes[i].live = false;
+        nodes[i].level = kFree;
+        freeNodes.push_back(i);
+    }
+
+    void link(uint32_t i, int k, int s) {
+        Node& n = nodes[i];
+        n.level = (int8_t)k;
+        n.slot = (uint8_t)s;
+        n.prev = kNil;
+        n.next = head[k][s];
+        if (n.next != kNil) nodes[n.next].prev = i;
+        head[k][s] = i;
+        occupied[k][s >> 6] |= 1ull << (s & 63);
+    }
+
+    void unlink(uint32_t i) {
+        Node& n = nodes[i];
+        if (n.prev != kNil) nodes[n.prev].next = n.next;
+        else head[n.level][n.slot] = n.next;
+        if (n.next != kNil) nodes[n.next].prev = n.prev;
+        if (head[n.level][n.slot] == kNil) occupied[n.level][n.slot >> 6] &= ~(1ull << (n.slot & 63));
+    }
+
+    void place(uint32_t i) {
+        long long t = std::max(nodes[i].item.time, cur);
+        if (haveReady && t <= readyTime) {
+            nodes[i].level = kInReady;
+            ready.push_back(i);
+            return;
+        }
+        for (int k = 0; k < kLevels; k++) {
+            if ((t >> (kBits * (k + 1))) == (cur >> (kBits * (k + 1)))) {
+                link(i, k, (int)((t >> (kBits * k)) & (kSlots - 1)));
+                return;
+            }
+        }
+        nodes[i].level = kInOverflow;
+        overflow.push(Deferred(t, i));
+    }
+
+    int nextOccupied(int k, int from) const {
+        for (int w = from >> 6; w < kSlots / 64; w++) {
+            uint64_t bits = occupied[k][w];
+            if (w == from >> 6) bits &= ~0ull << (from & 63);
+            if (bits) return (w << 6) + __builtin_ctzll(bits);
+        }
+        return -1;
+    }
+
+    // Moves the next due slot into ready, cascading higher levels and
+    // draining the overflow list on the way. False if nothing is pending.
+    bool advance() {
+        ready.clear();
+        readyPos = 0;
+        long long t = haveReady ? readyTime + 1 : cur;
+        haveReady = false;
+        while (true) {
+            bool cascaded = false;
+            for (int k = 0; k < kLevels && !cascaded; k++) {
+                // Level k holds cur's current rotation; once t has left it, it is empty.
+                if ((t >> (kBits * (k + 1))) != (cur >> (kBits * (k + 1)))) continue;
+                int s = nextOccupied(k, (int)((t >> (kBits * k)) & (kSlots - 1)));
+                if (s < 0) continue;
+                long long start = ((t >> (kBits * (k + 1))) << (kBits * (k + 1))) | ((long long)s << (kBits * k));
+                cur = std::max(start, t);
+                uint32_t i = head[k][s];
+                head[k][s] = kNil;
+                occupied[k][s >> 6] &= ~(1ull << (s & 63));
+                if (k == 0) {
+                    for (; i != kNil; i = nodes[i].next) {
+                        nodes[i].level = kInReady;
+                        ready.push_back(i);
+                    }
+                    std::sort(ready.begin(), ready.end(),
+                        [this](uint32_t a, uint32_t b) { return nodes[b].item > nodes[a].item; });
+                    readyTime = cur;
+                    haveReady = true;
+                    return true;
+                }
+                while (i != kNil) {
+                    uint32_t next = nodes[i].next;
+                    place(i);
+                    i = next;
+                }
+                t = cur;
+                cascaded = true;
+            }
+            if (cascaded) continue;
+
+            // Every level is empty: restart the wheel at the earliest overflow
+            // timer and bring in everything within the top level's reach.
+            while (!overflow.empty() && !nodes[overflow.top().second].live) {
+                freeNode(overflow.top().second);
+                overflow.pop();
+            }
+            if (overflow.empty()) return false;
+            cur = t = overflow.top().first;
+            long long reach = ((cur >> (kBits * kLevels)) + 1) << (kBits * kLevels);
+            while (!overflow.empty() && overflow.top().first < reach) {
+                uint32_t i = overflow.top().second;
+                overflow.pop();
+                if (nodes[i].live) place(i);
+                else freeNode(i);
+            }
+        }
+    }
+
+public:
+    TimingWheel() {
+        for (int k = 0; k < kLevels; k++) {
+            for (int s = 0; s < kSlots; s++) head[k][s] = kNil;
+            for (int w = 0; w < kSlots / 64; w++) occupied[k][w] = 0;
+        }
+    }
+
+    TimerId insert(const T& e) {
+        uint32_t i = allocNode(e);
+        place(i);
+        live++;
+        return ((TimerId)nodes[i].gen << 32) | i;
+    }
+
+    // False if the timer already fired or was cancelled.
+    bool cancel(TimerId id) {
+        uint32_t i = (uint32_t)id;
+        if (i >= nodes.size() || nodes[i].gen != (uint32_t)(id >> 32) || !nodes[i].live) return false;
+        if (nodes[i].level >= 0) {
+            unlink(i);
+            freeNode(i);
+        }
+        else nodes[i].live = false; // ready and overflow entries are dropped when reached
+        live--;
+        return true;
+    }
+
+    void push(const T& e) override { insert(e); }
+
+    const T& top() override {
+        while (true) {
+            while (readyPos < ready.size() && !nodes[ready[readyPos]].live) freeNode(ready[readyPos++]);
+            if (readyPos < ready.size()) return nodes[ready[readyPos]].item;
+            advance();
+        }
+    }
+
+    void pop() override {
+        top();
+        freeNode(ready[readyPos++]);
+        live--;
+    }
+
+    size_t size() const override { return live; }
+};
+
+// Calendar queue (Brown 1988): a ring of day-wide buckets, each a list
+// sorted by (time, seq), covering one "year" of nbuckets * width ticks from
+// the day cursor. Events beyond the year wait in a min-heap and move into the
+// bucket that frees up as the cursor passes each day, so a bucket only ever
+// holds one day. The bucket count doubles or halves as the event count
+// crosses 2x or 0.5x of it; the day width is re-estimated from the spacing of
+// the earliest events at each resize, and also whenever pops scan too many
+// empty days or inserts walk too far, giving amortized O(1) enqueue and
+// dequeue across event-count regimes.
+template <typename T>
+class CalendarQueue : public EventList<T> {
+    enum : uint32_t { kNil = 0xffffffffu };
+    struct Node {
+        T item;
+        uint32_t next;
+    };
+    struct Later {
+        const std::vector<Node>* nodes;
+        bool operator()(uint32_t a, uint32_t b) const { return (*nodes)[a].item > (*nodes)[b].item; }
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::vector<uint32_t> buckets; // list heads
+    std::vector<uint32_t> tails;   // list tails, so in-order inserts append in O(1)
+    std::vector<uint32_t> future;  // min-heap of events at or past yearEnd
+    long long width = 1;
+    long long base = 0;     // start of the day cursor's day
+    long long yearEnd = 0;  // base + nbuckets * width
+    size_t day = 0;         // bucket of the day cursor
+    size_t count = 0, inBuckets = 0;
+    size_t ops = 0, steps = 0; // since the last resize: pops and pushes, empty days scanned + list nodes walked
+
+    size_t bucketOf(long long t) const { return (size_t)((t / width) % (long long)buckets.size()); }
+
+    void place(uint32_t i) {
+        if (nodes[i].item.time >= yearEnd) {
+            future.push_back(i);
+            std::push_heap(future.begin(), future.end(), Later{ &nodes });
+            return;
+        }
+        inBuckets++;
+        size_t b = bucketOf(nodes[i].item.time);
+        if (buckets[b] == kNil || nodes[i].item > nodes[tails[b]].item) {
+            // Common case (and every tie, since seq grows): append.
+            nodes[i].next = kNil;
+            if (buckets[b] == kNil) buckets[b] = i;
+            else nodes[tails[b]].next = i;
+            tails[b] = i;
+            return;
+        }
+        uint32_t* link = &buckets[b];
+        while (nodes[i].item > nodes[*link].item) {
+            link = &nodes[*link].next;
+            steps++;
+        }
+        nodes[i].next = *link;
+        *link = i;
+    }
+
+    void moveCursor(long long dayStart) {
+        base = dayStart;
+        yearEnd = base + (long long)buckets.size() * width;
+        day = bucketOf(base);
+        while (!future.empty() && nodes[future.front()].item.time < yearEnd) {
+            uint32_t i = future.front();
+            std::pop_heap(future.begin(), future.end(), Later{ &nodes });
+            future.pop_back();
+            place(i);
+        }
+    }
+
+    // Moves the day cursor to the earliest event's bucket.
+    void findTop() {
+        if (inBuckets == 0) {
+            // Nothing this year: jump straight to the earliest future event.
+            long long t = nodes[future.front()].item.time;
+            moveCursor(t - t % width);
+        }
+        while (buckets[day] == kNil) {
+            moveCursor(base + width);
+            steps++;
+        }
+    }
+
+    // Rebuilds with nb buckets, re-estimating the day width as three times the
+    // mean gap among up to 25 of the earliest events (Brown's rule).
+    void resize(size_t nb) {
+        std::vector<uint32_t> all(future);
+        all.reserve(count);
+        for (uint32_t head : buckets)
+            for (uint32_t i = head; i != kNil; i = nodes[i].next) all.push_back(i);
+        // Fully sorted, so re-insertion below always appends and the
+        // leftover future events already form a heap.
+        std::sort(all.begin(), all.end(), [this](uint32_t a, uint32_t b) { return nodes[b].item > nodes[a].item; });
+        size_t sample = std::min<size_t>(all.size(), 25);
+        if (sample > 1) {
+            long long span = nodes[all[sample - 1]].item.time - nodes[all[0]].item.time;
+            width = std::max(1LL, 3 * span / (long long)(sample - 1));
+        }
+        buckets.assign(nb, kNil);
+        tails.assign(nb, kNil);
+        future.clear();
+        inBuckets = 0;
+        ops = steps = 0;
+        if (all.empty()) return;
+        long long t = nodes[all[0]].item.time;
+        moveCursor(t - t % width);
+        for (uint32_t i : all) place(i);
+    }
+
+    // Too many empty days per pop or nodes walked per push means the width
+    // no longer fits the event spacing.
+    void checkWidth() {
+        if (++ops >= std::max<size_t>(buckets.size(), 64)) {
+            if (steps > 4 * ops) resize(buckets.size());
+            ops = steps = 0;
+        }
+    }
+
+public:
+    CalendarQueue() : buckets(2, kNil), tails(2, kNil) { yearEnd = 2; }
+
+    void push(const T& e) override {
+        uint32_t i;
+        if (!freeNodes.empty()) {
+            i = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[i].item = e;
+        }
+        else {
+            i = (uint32_t)nodes.size();
+            nodes.push_back(Node{ e, kNil });
+        }
+        count++;
+        if (count == 1) moveCursor(e.time - e.time % width);
+        if (e.time < base) {
+            // Earlier than the day cursor: rebuild around it.
+            future.push_back(i);
+            resize(buckets.size());
+        }
+        else place(i);
+        if (count > 2 * buckets.size()) resize(buckets.size() * 2);
+        else checkWidth();
+    }
+
+    const T& top() override {
+        findTop();
+        return nodes[buckets[day]].item;
+    }
+
+    void pop() override {
+        findTop();
+        uint32_t i = buckets[day];
+        buckets[day] = nodes[i].next;
+        if (buckets[day] == kNil) tails[day] = kNil;
+        freeNodes.push_back(i);
+        count--;
+        inBuckets--;
+        if (buckets.size() > 2 && count < buckets.size() / 2) resize(buckets.size() / 2);
+        else checkWidth();
+    }
+
+    size_t size() const override { return count; }
+};
+
+template <typename T>
+static std::unique_ptr<EventList<T>> makeEventList(const std::string& kind) {
+    if (kind == "wheel") return std::unique_ptr<EventList<T>>(new TimingWheel<T>());
+    if (kind == "calendar") return std::unique_ptr<EventList<T>>(new CalendarQueue<T>());
+    return std::unique_ptr<EventList<T>>(new HeapEventList<T>());
+}
+
+/* =========================
+   HEADLESS SIMULATION
+   ========================= */
+// One self-contained simulation run in simulated time: no sleeps, no shared
+// globals, so independent runs can execute concurrently on a thread pool.
+struct SimConfig {
+    int quantum = 2, bufferCap = 10, cpus = 1;
+    std::vector<int> resources{ 10, 10, 10 };
+    SchedPolicy policy = SchedPolicy::RoundRobin;
+    long long processes = 1000; // 0: unlimited (needs a duration)
+    long long duration = 0;     // simulated time limit, 0: run until all processes finish
+    uint64_t seed = 1;
+    int pidMax = 32768;         // PIDs are 1..pidMax-1, recycled
+    Workload workload;
+    std::string eventList = "heap"; // heap, wheel, calendar
+    SwitchCost switchCost;
+    CacheGeometry cache;   // per CPU, off unless set
+    MemoryConfig memory;   // off unless frames > 0
+    TlbConfig tlb;         // per CPU, off unless set
+    KmemConfig kmem;       // interactive runs, off unless frames > 0
+    std::string tracePath; // single runs only
+    std::vector<std::pair<std::string, std::string>> labels; // swept parameters, for reporting
+};
+
+struct SimResult {
+    long long created = 0, completed = 0, stranded = 0, requeues = 0, unfinished = 0;
+    long long makespan = 0, busy = 0;
+    double throughput = 0, avgWait = 0, avgTurnaround = 0, utilization = 0;
+    long long waitP99 = 0, waitMax = 0;
+    long long ioTime = 0;   // time processes spent blocked on I/O, queueing included
+    double cpuIoOverlap = 0; // fraction of the makespan with a CPU and a device both busy
+    double avgBlocked = 0;   // time-averaged number of blocked processes
+    struct Device {
+        std::string name;
+        long long served;
+        double utilization, avgQueueWait;
+    };
+    std::vector<Device> devices;
+    struct Core {
+        long long accesses, hits;
+        double hitRatio;
+    };
+    std::vector<Core> cores;  // with a cache model
+    double cacheHitRatio = 0; // over all cores
+    double procHitMean = 0;   // per completed process hit ratio: mean and percentiles
+    double procHitP10 = 0, procHitP50 = 0, procHitP90 = 0;
+    long long pageFaults = 0, evictions = 0, faultTime = 0; // faultTime: blocked on page-ins, queueing included
+    double pagerUtilization = 0;
+    long long switches = 0, switchTime = 0; // context switches and their overhead + cache refill time
+    double tlbHitRatio = 0;                 // over translations, one per run of references to a page
+    long long tlbMisses = 0, tlbFlushes = 0, shootdowns = 0;
+    long long tlbWalkTime = 0, shootdownTime = 0; // charged on top of slices
+    double wsMean = 0;                     // aggregate working set of admitted processes, pages, mean over samples
+    long long wsPeak = 0;
+    long long suspensions = 0, suspendedTime = 0;
+    long long backlog = 0;  // remaining burst over the process table
+    size_t tableBytes = 0;
+};
+
+// Parses a whole decimal integer in [lo, hi], as strictly as applyParam;
+// for the command-line flags that are not simulation parameters.
+static bool parseInt(const char* text, long long lo, long long hi, long long* out) {
+    char* end = nullptr;
+    long long n = std::strtoll(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || n < lo || n > hi) return false;
+    *out = n;
+    return true;
+}
+
+// The same for a finite real number no smaller than lo.
+static bool parseReal(const char* text, double lo, double* out) {
+    char* end = nullptr;
+    double v = std::strtod(text, &end);
+    if (*text == '\0' || *end != '\0' || !std::isfinite(v) || v < lo) return false;
+    *out = v;
+    return true;
+}
+
+// Sets one named parameter from its text form; shared by sweep grids, config
+// files and the command line.
+static bool applyParam(SimConfig& cfg, const std::string& key, const std::string& val) {
+    char* end = nullptr;
+    long long n = std::strtoll(val.c_str(), &end, 10);
+    bool isInt = !val.empty() && *end == '\0';
+    if (key == "quantum" && isInt && n > 0) cfg.quantum = (int)n;
+    else if (key == "buffer" && isInt && n > 0) cfg.bufferCap = (int)n;
+    else if (key == "cpus" && isInt && n > 0) cfg.cpus = (int)n;
+    else if (key == "processes" && isInt && n >= 0) cfg.processes = n;
+    else if (key == "duration" && isInt && n >= 0) cfg.duration = n;
+    else if (key == "seed" && !val.empty() && val[0] != '-') {
+        cfg.seed = std::strtoull(val.c_str(), &end, 10);
+        return *end == '\0';
+    }
+    else if (key == "unit-ms" && isInt && n > 0) cfg.workload.msPerUnit = (int)n;
+    else if (key == "pid-max" && isInt && n >= 2 && n <= (1 << 22)) cfg.pidMax = (int)n;
+    else if (key == "trace") cfg.tracePath = val;
+    else if (key == "event-list" && (val == "heap" || val == "wheel" || val == "calendar")) cfg.eventList = val;
+    else if (key == "switch-cost" && isInt && n >= 0 && n <= 1000000) cfg.switchCost.overhead = (int)n;
+    else if (key == "cold-penalty" && isInt && n >= 0 && n <= 1000000) cfg.switchCost.coldPenalty = (int)n;
+    else if (key == "cache") return cfg.cache.parse(val);
+    else if (key == "access") return cfg.workload.access.parse(val);
+    else if (key == "frames" && isInt && n >= 0 && n <= (1 << 26)) cfg.memory.frames = (int)n;
+    else if (key == "page-size" && isInt && n >= 64 && n <= (1 << 30) && (n & (n - 1)) == 0) cfg.memory.pageSize = (int)n;
+    else if (key == "replace" && (val == "fifo" || val == "lru" || val == "clock" || val == "arc")) cfg.memory.policy = val;
+    else if (key == "page-in") return cfg.memory.pageIn.parse(val);
+    else if (key == "ws-window" && isInt && n >= 1) cfg.memory.wsWindow = n;
+    else if (key == "ws-interval" && isInt && n >= 1 && n <= 1000000) cfg.memory.wsInterval = (int)n;
+    else if (key == "memory-control" && (val == "off" || val == "ws")) cfg.memory.control = val == "ws";
+    else if (key == "kmem-frames" && isInt && n >= 0 && n <= (1 << 26)) cfg.kmem.frames = (int)n;
+    else if (key == "kmem-max-order" && isInt && n >= 0 && n <= BuddyAllocator::kMaxOrder) cfg.kmem.maxOrder = (int)n;
+    else if (key == "tlb") return cfg.tlb.parse(val);
+    else if (key == "tlb-asids" && isInt && n >= 0 && n <= 4096) cfg.tlb.asids = (int)n;
+    else if (key == "tlb-walk" && isInt && n >= 0 && n <= 1000) cfg.tlb.walkRefs = (int)n;
+    else if (key == "tlb-shootdown" && isInt && n >= 0 && n <= 1000000) cfg.tlb.shootdown = (int)n;
+    else if (key == "access-rate" && isInt && n > 0 && n <= 1000000) cfg.workload.access.rate = (int)n;
+    else if (key == "cache-decay" && isInt && n >= 0 && n <= 1000000000) cfg.switchCost.decay = (int)n;
+    else if (key == "demand") {
+        // "LO:HI" units per resource type
+        int lo = 0, hi = 0;
+        char sep = 0;
+        std::istringstream is(val);
+        if (!(is >> lo >> sep >> hi) || sep != ':' || lo < 0 || hi < lo || hi > 65535) return false;
+        cfg.workload.demandLo = lo;
+        cfg.workload.demandHi = hi;
+    }
+    else if (key == "policy") return parsePolicy(val, cfg.policy);
+    else if (key == "arrival") return cfg.workload.arrival.parse(val);
+    else if (key == "burst") return cfg.workload.burst.parse(val);
+    else if (key == "io" || key == "devices") {
+        // "io": one device's service time; "devices": "NAME@SPEC+NAME@SPEC..."
+        std::vector<IoDeviceModel> devices;
+        std::stringstream ss(key == "io" ? "io@" + val : val);
+        std::string item;
+        while (std::getline(ss, item, '+')) {
+            size_t at = item.find('@');
+            if (at == 0 || at == std::string::npos) return false;
+            IoDeviceModel d{ item.substr(0, at), BurstModel() };
+            if (!d.service.parse(item.substr(at + 1))) return false;
+            devices.push_back(d);
+        }
+        if (devices.empty()) return false;
+        cfg.workload.devices = devices;
+        cfg.workload.devicesSpec = ss.str();
+    }
+    else if (key == "io-bound") {
+        double f = std::strtod(val.c_str(), &end);
+        if (val.empty() || *end != '\0' || f < 0 || f > 1) return false;
+        cfg.workload.ioBound = f;
+    }
+    else if (key == "io-waits") {
+        // "LO:HI" I/O waits per process
+        int lo = 0, hi = 0;
+        char sep = 0;
+        std::istringstream is(val);
+        if (!(is >> lo >> sep >> hi) || sep != ':' || lo < 0 || hi < lo) return false;
+        cfg.workload.ioLo = lo;
+        cfg.workload.ioHi = hi;
+    }
+    else if (key == "resources") {
+        // "10x10x10": one total per resource type
+        std::vector<int> totals;
+        std::stringstream ss(val);
+        std::string item;
+        while (std::getline(ss, item, 'x')) {
+            long v = std::strtol(item.c_str(), &end, 10);
+            if (item.empty() || *end != '\0' || v <= 0 || v > INT_MAX) return false;
+            totals.push_back((int)v);
+        }
+        if (totals.empty()) return false;
+        cfg.resources = totals;
+    }
+    else return false;
+    return true;
+}
+
+class Simulation {
+private:
+    enum EventType { Arrival, SliceEnd, IoDone, PageIn, Sample };
+    static const uint64_t kNoFault = ~0ULL;
+    struct Event {
+        long long time;
+        uint64_t seq;
+        EventType type;
+        int cpu, slice;
+        ProcHandle p;
+        bool operator>(const Event& o) const { return time != o.time ? time > o.time : seq > o.seq; }
+    };
+
+    const SimConfig& cfg;
+    Rng rng;
+    ArrivalProcess arrivals;
+    ProcessTable table;
+    PidAllocator pids;
+    BoundedBuffer buffer;
+    ResourceManager rm;
+    Scheduler sch;
+    std::unique_ptr<EventList<Event>> events;
+    std::vector<bool> cpuBusy;
+    std::vector<long long> sliceStart; // per CPU, while busy
+    uint64_t seq = 0;
+    double clock = 0;          // arrival clock, fractional time units
+    ProcHandle blocked = kNoProc; // arrival waiting for buffer space
+    bool pidWait = false;         // arrival waiting for a free PID
+    std::map<int, bool> refused; // pid -> refused admission at least once, while tracing
+    TraceWriter trace;
+    long long totalWait = 0, totalTurnaround = 0;
+    HdrHistogram waits;
+    bool phased;                   // processes run SimTask bodies with I/O waits
+    std::vector<SimTask> tasks;    // by table row, while phased
+    std::vector<long long> ioTime; // by table row: I/O time so far
+    std::vector<long long> blockedAt; // by table row: when the current I/O was issued
+    struct Device {
+        std::deque<ProcHandle> queue;
+        ProcHandle serving = kNoProc;
+        long long busySince = 0, busy = 0, served = 0, queueWait = 0;
+    };
+    std::vector<Device> devices;
+    std::vector<SetAssocCache> caches;  // per CPU, with a cache model
+    std::unique_ptr<FramePool> memory;  // with a memory model
+    int pageBits = 0;
+    // By table row, with a cache or memory model:
+    std::vector<AccessStream> streams;
+    std::vector<long long> refs, hits;  // references and cache hits so far
+    std::vector<uint64_t> serials;      // creation number, naming the process's pages to the replacement policy
+    uint64_t streamsMade = 0;
+    HdrHistogram procHits;              // completed processes' hit ratios, permille
+    double procHitSum = 0;
+    // By table row, with a memory model:
+    std::vector<PageTable> pageTables;
+    std::vector<uint64_t> faultVa;      // reference waiting on a page-in (reissued on resume), or kNoFault
+    std::vector<int> partialRefs;       // references done toward the current, unfinished time unit
+    std::vector<long long> faultAt;     // when the pending fault was taken
+    Device pager;                       // serves page faults in FIFO order
+    std::vector<ProcHandle> handles;    // the row's process, kNoProc once finished
+    std::vector<int> wsPages;           // working-set estimate at the last sample
+    // Evicted pages by vpn, with the owner's reference count when they were
+    // last seen referenced; dropped once paged back in or out of the window.
+    std::vector<std::unordered_map<uint64_t, long long>> wsGhosts;
+    std::vector<long long> frameSeen;   // by frame: owner's reference count + 1 when its bit was last found set, 0 never
+    std::vector<uint8_t> suspendWanted; // chosen for suspension at its next return to the ready queue
+    std::vector<long long> suspendedAt;
+    std::deque<ProcHandle> suspended;   // swapped out, oldest first
+    long long wsBudget = 0, wsNewcomer = 1; // frames left for admissions until the next sample, and the charge for one
+    long long wsSamples = 0;
+    double wsTotal = 0;
+    // Per CPU, with a TLB model.
+    struct CpuTlb {
+        SetAssocCache entries;          // lines: asid << 36 | vpn
+        std::vector<uint64_t> owner;    // by ASID: process serial, kNoFault if free
+        std::vector<uint64_t> lastUsed; // by ASID
+        uint64_t current = kNoFault;    // serial of the address space in use
+        uint64_t asid = 0, clock = 0;
+        long long lookups = 0, misses = 0;
+        long long walkRefs = 0;         // page walk references not yet charged as a whole time unit
+        long long owed = 0;             // shootdown time to charge to the next slice
+    };
+    std::vector<CpuTlb> tlbs;
+    int nBlocked = 0;
+    long long lastEvent = 0;       // time up to which overlap and blocked counts are integrated
+    double overlap = 0, blockedArea = 0;
+    SimResult res;
+
+    void schedule(long long t, EventType type, int cpu, int slice, ProcHandle p) {
+        events->push(Event{ t, seq++, type, cpu, slice, p });
+    }
+
+    void scheduleArrival() {
+        if (cfg.processes > 0 && res.created + (blocked != kNoProc ? 1 : 0) >= cfg.processes) return;
+        clock += arrivals.nextGap(rng, clock);
+        schedule((long long)std::ceil(clock), Arrival, -1, 0, kNoProc);
+    }
+
+    // kNoProc if the PID space is exhausted.
+    ProcHandle makeProcess(long long now) {
+        int pid = pids.alloc();
+        if (pid < 0) return kNoProc;
+        int demand[16];
+        size_t nres = std::min<size_t>(cfg.resources.size(), 16);
+        rng.fillInt(demand, nres, cfg.workload.demandLo, cfg.workload.demandHi);
+        std::vector<int> d(demand, demand + nres);
+        d.resize(cfg.resources.size(), cfg.workload.demandLo);
+        ProcHandle p;
+        if (!phased) p = table.create(pid, now, cfg.workload.burst.sample(rng), d.data());
+        else {
+            bool ioBound = cfg.workload.ioBound >= 1 || rng.uniform01() < cfg.workload.ioBound;
+            int ioWaits = ioBound ? rng.uniformInt(cfg.workload.ioLo, cfg.workload.ioHi) : 0;
+            SimTask task = phasedProcess(&rng, &cfg.workload, ioWaits);
+            SimAction first = task.next(); // always a CPU burst
+            p = table.create(pid, now, first.amount, d.data());
+            if (p == kNoProc) return p;
+            uint32_t row = ProcessTable::index(p);
+            if (row >= tasks.size()) {
+                tasks.resize(row + 1);
+                ioTime.resize(row + 1);
+                blockedAt.resize(row + 1);
+            }
+            tasks[row] = std::move(task);
+            ioTime[row] = 0;
+        }
+        if (p != kNoProc && (!caches.empty() || memory || !tlbs.empty())) {
+            uint32_t row = ProcessTable::index(p);
+            if (row >= streams.size()) {
+                streams.resize(row + 1);
+                refs.resize(row + 1);
+                hits.resize(row + 1);
+                serials.resize(row + 1);
+                faultVa.resize(row + 1);
+                partialRefs.resize(row + 1);
+                if (memory) {
+                    pageTables.resize(row + 1);
+                    faultAt.resize(row + 1);
+                    handles.resize(row + 1);
+                    wsPages.resize(row + 1);
+                    wsGhosts.resize(row + 1);
+                    suspendWanted.resize(row + 1);
+                    suspendedAt.resize(row + 1);
+                }
+            }
+            // Own random stream (not rng), so the model leaves the schedule alone.
+            serials[row] = streamsMade;
+            streams[row] = AccessStream(&cfg.workload.access, cfg.seed, streamsMade++);
+            refs[row] = hits[row] = 0;
+            faultVa[row] = kNoFault;
+            partialRefs[row] = 0;
+            if (memory) {
+                handles[row] = p;
+                wsPages[row] = 0;
+                wsGhosts[row].clear();
+                suspendWanted[row] = 0;
+            }
+        }
+        return p;
+    }
+
+    void finish(ProcHandle p, long long now) {
+        long long turnaround = now - table.arrival(p);
+        long long wait = turnaround - table.burst(p) - (phased ? ioTime[ProcessTable::index(p)] : 0);
+        totalTurnaround += turnaround;
+        totalWait += wait;
+        waits.record((uint64_t)wait);
+        if (!caches.empty() && refs[ProcessTable::index(p)] > 0) {
+            double ratio = (double)hits[ProcessTable::index(p)] / refs[ProcessTable::index(p)];
+            procHits.record((uint64_t)std::lround(ratio * 1000));
+            procHitSum += ratio;
+        }
+        res.completed++;
+        rm.releaseAll(p);
+        if (memory) {
+            swapOut(p);
+            handles[ProcessTable::index(p)] = kNoProc;
+        }
+        table.state(p) = ProcState::Terminated;
+        if (phased) tasks[ProcessTable::index(p)] = SimTask();
+        pids.release(table.release(p));
+        if (pidWait) { // the parked arrival gets the PID just freed
+            pidWait = false;
+            clock = std::max(clock, (double)now);
+            schedule(now, Arrival, -1, 0, kNoProc);
+        }
+    }
+
+    // Frees every frame p holds.
+    void swapOut(ProcHandle p) {
+        PageTable& pt = pageTables[ProcessTable::index(p)];
+        FramePool* frames = memory.get();
+        pt.forEach([frames](uint64_t, uint32_t f) { frames->release(f); });
+        pt.clear();
+    }
+
+    // Back to the ready queue, unless the medium-term scheduler picked p
+    // for suspension: then it is swapped out and waits for memory.
+    void requeue(ProcHandle p, long long now) {
+        uint32_t row = ProcessTable::index(p);
+        if (!memory || !suspendWanted[row]) {
+            sch.addReady(p);
+            return;
+        }
+        suspendWanted[row] = 0;
+        table.state(p) = ProcState::Suspended;
+        if (!tlbs.empty()) shootdownAll(serials[row]); // no translation may outlive the frames
+        swapOut(p);
+        suspendedAt[row] = now;
+        suspended.push_back(p);
+        res.suspensions++;
+        if (trace.isOpen()) trace.async('b', "suspended", table.pid(p), now);
+    }
+
+    void resume(ProcHandle p, long long now) {
+        res.suspendedTime += now - suspendedAt[ProcessTable::index(p)];
+        if (trace.isOpen()) trace.async('e', "suspended", table.pid(p), now);
+        sch.addReady(p);
+    }
+
+    // Estimates each process's working set (Denning): the pages it touched
+    // in its own last ws-window references, from reference bits sampled
+    // every ws-interval. Pages evicted meanwhile still count. Windows are in
+    // the process's virtual time, so a process stalled on faults keeps its
+    // working set. With memory control, suspends the newest admitted
+    // processes until the working sets of the rest fit in memory, or
+    // resumes suspended ones, oldest first, while they fit.
+    void sampleWorkingSets(long long now) {
+        long long w = cfg.memory.wsWindow;
+        for (size_t r = 0; r < handles.size(); r++) {
+            if (handles[r] == kNoProc || table.state(handles[r]) == ProcState::Suspended) continue;
+            std::unordered_map<uint64_t, long long>& ghosts = wsGhosts[r];
+            for (auto it = ghosts.begin(); it != ghosts.end();) {
+                if (refs[r] + 1 - it->second >= w) it = ghosts.erase(it);
+                else ++it;
+            }
+            wsPages[r] = (int)ghosts.size();
+        }
+        for (uint32_t f = 0; f < memory->frames(); f++) {
+            ProcHandle o = memory->owner(f);
+            if (o == kNoProc) continue;
+            uint32_t r = ProcessTable::index(o);
+            if (memory->testAndClearReferenced(f)) frameSeen[f] = refs[r] + 1;
+            if (frameSeen[f] && refs[r] + 1 - frameSeen[f] < w) wsPages[r]++;
+        }
+
+        std::vector<ProcHandle> active; // admitted and not suspended
+        long long total = 0;
+        for (ProcHandle p : handles) {
+            if (p == kNoProc) continue;
+            ProcState st = table.state(p);
+            if (st == ProcState::New || st == ProcState::Suspended) continue;
+            active.push_back(p);
+            total += wsPages[ProcessTable::index(p)];
+        }
+        wsSamples++;
+        wsTotal += total;
+        res.wsPeak = std::max(res.wsPeak, total);
+        if (!cfg.memory.control) return;
+
+        long long frames = memory->frames();
+        std::sort(active.begin(), active.end(), [this](ProcHandle a, ProcHandle b) {
+            return table.arrival(a) != table.arrival(b) ? table.arrival(a) > table.arrival(b) : a > b;
+        });
+        size_t kept = active.size();
+        for (ProcHandle p : active) {
+            uint32_t row = ProcessTable::index(p);
+            suspendWanted[row] = total > frames && kept > 1;
+            if (suspendWanted[row]) {
+                total -= wsPages[row];
+                kept--;
+            }
+        }
+        while (kept == active.size() && !suspended.empty()) {
+            ProcHandle p = suspended.front();
+            if (kept > 0 && total + wsPages[ProcessTable::index(p)] > frames) break;
+            suspended.pop_front();
+            total += wsPages[ProcessTable::index(p)];
+            resume(p, now);
+            active.push_back(p);
+            kept++;
+        }
+        wsBudget = frames - total;
+        wsNewcomer = std::max(1LL, kept ? total / (long long)kept : 1);
+    }
+
+    // Starts serving the head of device d's queue.
+    void startIo(int d, long long now) {
+        Device& dev = devices[d];
+        ProcHandle p = dev.queue.front();
+        dev.queue.pop_front();
+        dev.serving = p;
+        dev.busySince = now;
+        dev.queueWait += now - blockedAt[ProcessTable::index(p)];
+        int service = cfg.workload.devices[d].service.sample(rng);
+        schedule(now + service, IoDone, d, service, p);
+    }
+
+    void ioDone(int d, int service, long long now) {
+        Device& dev = devices[d];
+        ProcHandle p = dev.serving;
+        dev.busy += service;
+        dev.served++;
+        dev.serving = kNoProc;
+        long long blockedFor = now - blockedAt[ProcessTable::index(p)];
+        ioTime[ProcessTable::index(p)] += blockedFor;
+        res.ioTime += blockedFor;
+        nBlocked--;
+        if (trace.isOpen()) trace.async('e', "io", table.pid(p), now);
+        advance(p, now);
+        if (!dev.queue.empty()) startIo(d, now);
+    }
+
+    // Runs up to n of p's memory references on cpu, translated through the
+    // CPU's TLB and p's page table (either may be off) and then through the
+    // CPU's cache if there is one. Stops at a reference to a non-resident
+    // page, leaving it in faultVa; returns the references completed. Each
+    // page counts as referenced once per run of consecutive references to
+    // it.
+    long long runRefs(ProcHandle p, int cpu, long long n) {
+        uint32_t row = ProcessTable::index(p);
+        AccessStream& stream = streams[row];
+        PageTable* pt = memory ? &pageTables[row] : nullptr;
+        SetAssocCache* cache = caches.empty() ? nullptr : &caches[cpu];
+        CpuTlb* tlb = tlbs.empty() ? nullptr : &tlbs[cpu];
+        uint64_t asidBits = tlb ? tlb->asid << (PageTable::kLevels * PageTable::kBits) : 0;
+        uint64_t lastVpn = kNoFault, frameBase = 0, offsetMask = (1ULL << pageBits) - 1;
+        long long i = 0, h = 0, lookups = 0, misses = 0;
+        for (; i < n; i++) {
+            // The page-in stands for the reissued reference's own touch, so
+            // a page needs a second reference to count as reused.
+            uint64_t va = faultVa[row];
+            bool reissued = va != kNoFault;
+            if (reissued) faultVa[row] = kNoFault;
+            else va = stream.next();
+            uint64_t vpn = (va >> pageBits) & PageTable::kVpnMask;
+            if (vpn != lastVpn) {
+                if (pt) {
+                    long long f = pt->lookup(vpn);
+                    if (f < 0) {
+                        faultVa[row] = va;
+                        break;
+                    }
+                    if (!reissued) memory->touch((uint32_t)f);
+                    frameBase = (uint64_t)f << pageBits;
+                }
+                else frameBase = stream.base() + (va & ~offsetMask);
+                // Not-present pages never enter the TLB, so it is asked only
+                // once the translation is known to exist.
+                if (tlb) {
+                    lookups++;
+                    misses += !tlb->entries.accessLine(asidBits | vpn);
+                }
+                lastVpn = vpn;
+            }
+            if (cache) h += cache->access(frameBase | (va & offsetMask));
+        }
+        refs[row] += i;
+        hits[row] += h;
+        if (tlb) {
+            tlb->lookups += lookups;
+            tlb->misses += misses;
+            tlb->walkRefs += misses * cfg.tlb.walkRefs;
+        }
+        return i;
+    }
+
+    // Points cpu's TLB at the address space of the process numbered serial.
+    void switchTlb(int cpu, uint64_t serial) {
+        CpuTlb& t = tlbs[cpu];
+        if (t.current == serial) return;
+        t.current = serial;
+        if (cfg.tlb.asids == 0) {
+            t.entries.flush();
+            res.tlbFlushes++;
+            return;
+        }
+        size_t a = 0, lru = 0;
+        for (; a < t.owner.size() && t.owner[a] != serial; a++)
+            if (t.lastUsed[a] < t.lastUsed[lru]) lru = a;
+        if (a == t.owner.size()) {
+            // Recycle the least recently used ASID, dropping its entries.
+            a = lru;
+            if (t.owner[a] != kNoFault) {
+                uint64_t shift = PageTable::kLevels * PageTable::kBits;
+                t.entries.invalidateIf([a, shift](uint64_t ln) { return (ln >> shift) == a; });
+                res.tlbFlushes++;
+            }
+            t.owner[a] = serial;
+        }
+        t.lastUsed[a] = ++t.clock;
+        t.asid = a;
+    }
+
+    // The ASID serial's address space holds on t, or -1 if it is not live
+    // there (without ASIDs, live means t's current context, tagged 0).
+    long liveAsid(const CpuTlb& t, uint64_t serial) const {
+        if (cfg.tlb.asids == 0) return t.current == serial ? 0 : -1;
+        for (size_t a = 0; a < t.owner.size(); a++)
+            if (t.owner[a] == serial) return (long)a;
+        return -1;
+    }
+
+    // An evicted page's translation may be cached by every CPU the owner's
+    // address space is live on; each one drops it and pays the shootdown.
+    void shootdown(uint64_t serial, uint64_t vpn) {
+        for (CpuTlb& t : tlbs) {
+            long a = liveAsid(t, serial);
+            if (a < 0) continue;
+            t.entries.invalidateLine(((uint64_t)a << (PageTable::kLevels * PageTable::kBits)) | vpn);
+            t.owed += cfg.tlb.shootdown;
+            res.shootdowns++;
+        }
+    }
+
+    // A suspended process loses every frame at once, so each CPU it is live
+    // on drops all of its entries in a single shootdown.
+    void shootdownAll(uint64_t serial) {
+        uint64_t shift = PageTable::kLevels * PageTable::kBits;
+        for (CpuTlb& t : tlbs) {
+            long a = liveAsid(t, serial);
+            if (a < 0) continue;
+            t.entries.invalidateIf([a, shift](uint64_t ln) { return (long)(ln >> shift) == a; });
+            t.owed += cfg.tlb.shootdown;
+            res.shootdowns++;
+        }
+    }
+
+    // Time units of TLB overhead to add to the slice just run on cpu: page
+    // walks in whole units of access-rate references, plus shootdowns
+    // taken since the CPU's last slice.
+    int tlbCharge(int cpu) {
+        CpuTlb& t = tlbs[cpu];
+        long long rate = cfg.workload.access.rate;
+        long long walk = t.walkRefs / rate;
+        t.walkRefs %= rate;
+        res.tlbWalkTime += walk;
+        res.shootdownTime += t.owed;
+        long long units = walk + t.owed;
+        t.owed = 0;
+        return (int)units;
+    }
+
+    void pageFault(ProcHandle p, long long now) {
+        sch.block(p);
+        faultAt[ProcessTable::index(p)] = now;
+        nBlocked++;
+        res.pageFaults++;
+        if (trace.isOpen()) trace.async('b', "page fault", table.pid(p), now);
+        pager.queue.push_back(p);
+        if (pager.serving == kNoProc) startPageIn(now);
+    }
+
+    void startPageIn(long long now) {
+        ProcHandle p = pager.queue.front();
+        pager.queue.pop_front();
+        pager.serving = p;
+        pager.busySince = now;
+        pager.queueWait += now - faultAt[ProcessTable::index(p)];
+        int service = cfg.memory.pageIn.sample(rng);
+        schedule(now + service, PageIn, -1, service, p);
+    }
+
+    // Maps the faulting page into a frame, evicting another page if memory
+    // is full, and makes the process ready again.
+    void pageInDone(int service, long long now) {
+        ProcHandle p = pager.serving;
+        uint32_t row = ProcessTable::index(p);
+        pager.busy += service;
+        pager.served++;
+        pager.serving = kNoProc;
+        nBlocked--;
+        res.faultTime += now - faultAt[row];
+        uint64_t vpn = (faultVa[row] >> pageBits) & PageTable::kVpnMask;
+        ProcHandle victim;
+        uint64_t victimVpn = 0;
+        uint32_t f = memory->load(p, vpn, (serials[row] << 36) | vpn, &victim, &victimVpn);
+        if (victim != kNoProc) {
+            uint32_t vrow = ProcessTable::index(victim);
+            pageTables[vrow].unmap(victimVpn);
+            long long seen = memory->evictedReferenced() ? refs[vrow] + 1 : frameSeen[f];
+            if (seen) wsGhosts[vrow][victimVpn] = seen;
+            if (!tlbs.empty()) shootdown(serials[vrow], victimVpn);
+            res.evictions++;
+        }
+        pageTables[row].map(vpn, f);
+        frameSeen[f] = 0;
+        wsGhosts[row].erase(vpn);
+        if (trace.isOpen()) trace.async('e', "page fault", table.pid(p), now);
+        requeue(p, now);
+        if (!pager.queue.empty()) startPageIn(now);
+    }
+
+    // Time-weighted CPU/device overlap and blocked count over [lastEvent, t).
+    void integrate(long long t) {
+        long long dt = t - lastEvent;
+        if (dt <= 0) return;
+        bool cpuAny = std::find(cpuBusy.begin(), cpuBusy.end(), true) != cpuBusy.end();
+        bool ioAny = false;
+        for (const Device& dev : devices) ioAny = ioAny || dev.serving != kNoProc;
+        if (cpuAny && ioAny) overlap += dt;
+        blockedArea += (double)nBlocked * dt;
+        lastEvent = t;
+    }
+
+    // Resumes p's body after a finished CPU burst or I/O wait. Processes keep
+    // their granted resources while waiting on I/O.
+    void advance(ProcHandle p, long long now) {
+        SimAction a = tasks[ProcessTable::index(p)].next();
+        switch (a.kind) {
+        case SimAction::Cpu:
+            table.burst(p) += a.amount;
+            table.remaining(p) = a.amount;
+            requeue(p, now);
+            break;
+        case SimAction::Io:
+            sch.block(p);
+            blockedAt[ProcessTable::index(p)] = now;
+            nBlocked++;
+            if (trace.isOpen()) trace.async('b', "io", table.pid(p), now);
+            devices[a.amount].queue.push_back(p);
+            if (devices[a.amount].serving == kNoProc) startIo(a.amount, now);
+            break;
+        case SimAction::Exit:
+            finish(p, now);
+            break;
+        }
+    }
+
+    // Mirrors cpuThread: buffered processes enter the ready queue only if
+    // their whole demand can be granted, otherwise they go back in line.
+    void admit(long long now) {
+        for (int n = buffer.size(); n > 0; n--) {
+            // Memory control admits no one while processes are suspended or
+            // the working sets leave too little room for a newcomer.
+            if (memory && cfg.memory.control && (!suspended.empty() || wsBudget < wsNewcomer)) return;
+            ProcHandle p = buffer.tryPop();
+            if (rm.requestResources(p)) {
+                sch.addReady(p);
+                wsBudget -= wsNewcomer;
+                if (trace.isOpen()) {
+                    trace.async('e', "buffer", table.pid(p), now);
+                    if (refused.erase(table.pid(p))) trace.async('e', "resource wait", table.pid(p), now);
+                }
+            }
+            else {
+                buffer.tryPush(p);
+                res.requeues++;
+                if (trace.isOpen() && refused.insert({ table.pid(p), true }).second)
+                    trace.async('b', "resource wait", table.pid(p), now);
+            }
+        }
+    }
+
+    void pushed(ProcHandle p, long long now) {
+        res.created++;
+        if (trace.isOpen()) trace.async('b', "buffer", table.pid(p), now);
+    }
+
+    void fillCpus(long long now) {
+        for (int c = 0; c < cfg.cpus; c++) {
+            if (cpuBusy[c]) continue;
+            int slice, cost = 0;
+            ProcHandle p = sch.take(c, slice, cost);
+            if (p == kNoProc) return;
+            cpuBusy[c] = true;
+            sliceStart[c] = now;
+            int tlbTime = 0;
+            if (memory || !tlbs.empty()) {
+                // A fault cuts the slice short after the time units completed
+                // before it; the rest of the unit carries over.
+                uint32_t row = ProcessTable::index(p);
+                long long rate = cfg.workload.access.rate;
+                long long want = (long long)slice * rate - partialRefs[row];
+                if (!tlbs.empty()) switchTlb(c, serials[row]);
+                long long done = runRefs(p, c, want);
+                long long total = partialRefs[row] + done;
+                slice = (int)(total / rate);
+                partialRefs[row] = (int)(total % rate);
+                if (!tlbs.empty()) tlbTime = tlbCharge(c);
+            }
+            else if (!caches.empty()) {
+                // The slice's memory references, through this CPU's cache.
+                uint32_t row = ProcessTable::index(p);
+                long long n = (long long)slice * cfg.workload.access.rate;
+                refs[row] += n;
+                hits[row] += streams[row].run(caches[c], n);
+            }
+            if (trace.isOpen()) {
+                if (cost > 0) trace.complete(TraceWriter::kSimPid, c, "cpu", "switch", table.pid(p), now, cost);
+                trace.complete(TraceWriter::kSimPid, c, "cpu", "run", table.pid(p), now + cost, slice);
+                if (tlbTime > 0) trace.complete(TraceWriter::kSimPid, c, "cpu", "tlb", table.pid(p), now + cost + slice, tlbTime);
+            }
+            // TLB time stalls the process: the CPU is busy but the burst
+            // does not advance.
+            schedule(now + cost + slice + tlbTime, SliceEnd, c, slice, p);
+        }
+    }
+
+public:
+    explicit Simulation(const SimConfig& c)
+        : cfg(c), rng(c.seed, kStreamProducer), arrivals(c.workload.arrival),
+          table((int)c.resources.size()), pids(c.pidMax), buffer(c.bufferCap), rm(c.resources, &table),
+          sch(c.quantum, c.policy, &table, c.cpus, c.switchCost), events(makeEventList<Event>(c.eventList)), cpuBusy(c.cpus, false),
+          sliceStart(c.cpus, 0), phased(c.workload.ioHi > 0), devices(c.workload.devices.size()) {
+        if (!c.tracePath.empty() && trace.open(c.tracePath)) {
+            trace.processName(TraceWriter::kSimPid, "Simulated CPUs");
+            for (int i = 0; i < c.cpus; i++) trace.threadName(TraceWriter::kSimPid, i, ("CPU " + std::to_string(i)).c_str());
+        }
+        if (c.cache.enabled()) caches.assign(c.cpus, SetAssocCache(c.cache));
+        pageBits = __builtin_ctz((unsigned)c.memory.pageSize);
+        if (c.memory.frames > 0) {
+            memory.reset(new FramePool((uint32_t)c.memory.frames, c.memory.policy));
+            frameSeen.assign(c.memory.frames, 0);
+        }
+        if (c.tlb.enabled()) {
+            tlbs.resize(c.cpus);
+            for (CpuTlb& t : tlbs) {
+                t.entries.configure(c.tlb.entries);
+                t.owner.assign(c.tlb.asids, uint64_t(kNoFault));
+                t.lastUsed.assign(c.tlb.asids, 0);
+            }
+        }
+    }
+
+    SimResult run() {
+        scheduleArrival();
+        if (memory) {
+            wsBudget = memory->frames();
+            schedule(cfg.memory.wsInterval, Sample, -1, 0, kNoProc);
+        }
+        long long now = 0;
+        while (!events->empty()) {
+            Event e = events->top();
+            // Only the sampler is left: stop unless it still has to release
+            // someone, a suspended process or buffered ones the working-set
+            // budget is holding back until the next sample.
+            if (e.type == Sample && events->size() == 1 && suspended.empty() &&
+                !(cfg.memory.control && buffer.size() > 0 && wsBudget < wsNewcomer))
+                break;
+            if (cfg.duration > 0 && e.time > cfg.duration) {
+                // Out of time: count the covered part of running slices.
+                now = cfg.duration;
+                integrate(now);
+                for (int c = 0; c < cfg.cpus; c++)
+                    if (cpuBusy[c]) res.busy += now - sliceStart[c];
+                for (Device& dev : devices)
+                    if (dev.serving != kNoProc) dev.busy += now - dev.busySince;
+                if (pager.serving != kNoProc) pager.busy += now - pager.busySince;
+                break;
+            }
+            events->pop();
+            integrate(e.time);
+            now = e.time;
+
+            if (e.type == Arrival) {
+                ProcHandle p = makeProcess(now);
+                if (p == kNoProc) pidWait = true; // finish() re-admits it once a PID frees up
+                else if (buffer.tryPush(p)) { pushed(p, now); scheduleArrival(); }
+                else blocked = p;
+            }
+            else if (e.type == SliceEnd) {
+                ProcHandle p = e.p;
+                cpuBusy[e.cpu] = false;
+                res.busy += now - sliceStart[e.cpu];
+                if (memory && faultVa[ProcessTable::index(p)] != kNoFault) {
+                    table.remaining(p) -= e.slice; // stays positive: the fault came before the slice's end
+                    pageFault(p, now);
+                }
+                else if ((table.remaining(p) -= e.slice) > 0) requeue(p, now);
+                else if (phased) advance(p, now);
+                else finish(p, now);
+            }
+            else if (e.type == PageIn) pageInDone(e.slice, now);
+            else if (e.type == Sample) {
+                sampleWorkingSets(now);
+                schedule(now + cfg.memory.wsInterval, Sample, -1, 0, kNoProc);
+            }
+            else ioDone(e.cpu, e.slice, now);
+
+            admit(now);
+            if (blocked != kNoProc && buffer.tryPush(blocked)) {
+                pushed(blocked, now);
+                blocked = kNoProc;
+                clock = std::max(clock, (double)now);
+                scheduleArrival();
+            }
+            admit(now);
+            fillCpus(now);
+        }
+
+        for (ProcHandle p : suspended) res.suspendedTime += now - suspendedAt[ProcessTable::index(p)];
+        if (wsSamples > 0) res.wsMean = wsTotal / wsSamples;
+        res.stranded = buffer.size() + (blocked != kNoProc ? 1 : 0);
+        res.unfinished = res.created - res.completed;
+        res.makespan = now;
+        res.waitP99 = (long long)waits.percentile(99);
+        res.waitMax = (long long)waits.max();
+        if (!caches.empty()) {
+            long long refsAll = 0, hitsAll = 0;
+            for (const SetAssocCache& cache : caches) {
+                long long n = (long long)(cache.hitCount() + cache.missCount()), h = (long long)cache.hitCount();
+                res.cores.push_back(SimResult::Core{ n, h, n > 0 ? (double)h / n : 0 });
+                refsAll += n;
+                hitsAll += h;
+            }
+            res.cacheHitRatio = refsAll > 0 ? (double)hitsAll / refsAll : 0;
+            if (procHits.count() > 0) {
+                res.procHitMean = procHitSum / procHits.count();
+                res.procHitP10 = procHits.percentile(10) / 1000.0;
+                res.procHitP50 = procHits.percentile(50) / 1000.0;
+                res.procHitP90 = procHits.percentile(90) / 1000.0;
+            }
+        }
+        if (!tlbs.empty()) {
+            long long lookups = 0;
+            for (const CpuTlb& t : tlbs) {
+                lookups += t.lookups;
+                res.tlbMisses += t.misses;
+            }
+            res.tlbHitRatio = lookups > 0 ? 1 - (double)res.tlbMisses / lookups : 0;
+        }
+        res.switches = sch.switchCount();
+        res.switchTime = sch.switchCost();
+        res.backlog = table.remainingWork();
+        res.tableBytes = table.bytes();
+        if (res.completed > 0) {
+            res.avgWait = (double)totalWait / res.completed;
+            res.avgTurnaround = (double)totalTurnaround / res.completed;
+        }
+        if (now > 0) {
+            res.throughput = (double)res.completed / now;
+            res.utilization = (double)res.busy / ((double)now * cfg.cpus);
+            res.cpuIoOverlap = overlap / now;
+            res.avgBlocked = blockedArea / now;
+            res.pagerUtilization = (double)pager.busy / now;
+        }
+        if (phased) {
+            for (size_t d = 0; d < devices.size(); d++) {
+                const Device& dev = devices[d];
+                res.devices.push_back(SimResult::Device{ cfg.workload.devices[d].name, dev.served,
+                    now > 0 ? (double)dev.busy / now : 0, dev.served > 0 ? (double)dev.queueWait / dev.served : 0 });
+            }
+        }
+        return res;
+    }
 };
 
-/* =========================
-   GLOBAL CONTROL
-   ========================= */
-static std::atomic<bool> gRunning{false};
-static std::atomic<bool> gStopAll{false};
-static int gPidCounter = 1;
-std::mutex gIoMtx; 
+static SimResult runSimulation(const SimConfig& cfg) {
+    Simulation sim(cfg);
+    return sim.run();
+}
 
-/* =========================
-   RANDOM HELPERS
-   ========================= */
-static int rndInt(int lo, int hi){
-    static thread_local std::mt19937 rng(std::random_device{}());
-    return std::uniform_int_distribution<int>(lo, hi)(rng);
+// Reads "key = value" lines ('#' starts a comment) into cfg; sets *seeded
+// if the file chooses the seed.
+static bool loadConfigFile(const std::string& path, SimConfig& cfg, bool* seeded) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open config " << path << "\n";
+        return false;
+    }
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); lineNo++) {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        auto trim = [](std::string t) {
+            size_t b = t.find_first_not_of(" \t\r"), e = t.find_last_not_of(" \t\r");
+            return b == std::string::npos ? std::string() : t.substr(b, e - b + 1);
+        };
+        if (trim(line).empty()) continue;
+        std::string key = eq == std::string::npos ? "" : trim(line.substr(0, eq));
+        std::string val = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+        if (!applyParam(cfg, key, val)) {
+            std::cerr << path << ":" << lineNo << ": bad setting '" << trim(line) << "'\n";
+            return false;
+        }
+        if (key == "seed") *seeded = true;
+    }
+    return true;
+}
+
+static void writeSummary(std::ostream& os, const SimConfig& cfg, const SimResult& r, double wallSecs) {
+    os << "{\n  \"config\": {\"quantum\": " << cfg.quantum << ", \"buffer\": " << cfg.bufferCap
+       << ", \"cpus\": " << cfg.cpus << ", \"resources\": [";
+    for (size_t i = 0; i < cfg.resources.size(); i++) os << (i ? ", " : "") << cfg.resources[i];
+    os << "], \"policy\": \"" << policyName(cfg.policy) << "\", \"processes\": " << cfg.processes
+       << ", \"duration\": " << cfg.duration << ", \"seed\": " << cfg.seed << ", \"pid_max\": " << cfg.pidMax << ", \"event_list\": \"" << cfg.eventList << "\""
+       << ", \"switch_cost\": " << cfg.switchCost.overhead << ", \"cold_penalty\": " << cfg.switchCost.coldPenalty
+       << ", \"cache_decay\": " << cfg.switchCost.decay << ", \"cache\": \"" << cfg.cache.spec
+       << "\", \"access\": \"" << cfg.workload.access.spec << "\", \"access_rate\": " << cfg.workload.access.rate
+       << ", \"frames\": " << cfg.memory.frames << ", \"page_size\": " << cfg.memory.pageSize << ", \"replace\": \""
+       << cfg.memory.policy << "\", \"page_in\": \"" << cfg.memory.pageIn.spec << "\", \"tlb\": \"" << cfg.tlb.spec
+       << "\", \"ws_window\": " << cfg.memory.wsWindow << ", \"ws_interval\": " << cfg.memory.wsInterval
+       << ", \"memory_control\": \"" << (cfg.memory.control ? "ws" : "off") << "\", \"tlb_asids\": " << cfg.tlb.asids << ", \"tlb_walk\": " << cfg.tlb.walkRefs << ", \"tlb_shootdown\": " << cfg.tlb.shootdown
+       << ", \"arrival\": \"" << cfg.workload.arrival.spec << "\", \"burst\": \"" << cfg.workload.burst.spec
+       << "\", \"demand\": \"" << cfg.workload.demandLo << ":" << cfg.workload.demandHi
+       << "\", \"devices\": \"" << cfg.workload.devicesSpec << "\", \"io_waits\": \"" << cfg.workload.ioLo << ":"
+       << cfg.workload.ioHi << "\", \"io_bound\": " << cfg.workload.ioBound << "},\n";
+    os << "  \"result\": {\"created\": " << r.created << ", \"completed\": " << r.completed
+       << ", \"unfinished\": " << r.unfinished << ", \"stranded\": " << r.stranded
+       << ", \"requeues\": " << r.requeues << ", \"makespan\": " << r.makespan << ", \"busy\": " << r.busy
+       << ", \"throughput\": " << r.throughput << ", \"avg_wait\": " << r.avgWait
+       << ", \"wait_p99\": " << r.waitP99 << ", \"wait_max\": " << r.waitMax
+       << ", \"avg_turnaround\": " << r.avgTurnaround << ", \"utilization\": " << r.utilization
+       << ", \"io_time\": " << r.ioTime << ", \"cpu_io_overlap\": " << r.cpuIoOverlap
+       << ", \"avg_blocked\": " << r.avgBlocked << ", \"switches\": " << r.switches
+       << ", \"switch_time\": " << r.switchTime << ", \"cache_hit_ratio\": " << r.cacheHitRatio
+       << ", \"proc_hit_mean\": " << r.procHitMean << ", \"proc_hit_p10\": " << r.procHitP10
+       << ", \"proc_hit_p50\": " << r.procHitP50 << ", \"proc_hit_p90\": " << r.procHitP90
+       << ", \"page_faults\": " << r.pageFaults << ", \"evictions\": " << r.evictions << ", \"fault_time\": " << r.faultTime
+       << ", \"pager_utilization\": " << r.pagerUtilization << ", \"ws_mean\": " << r.wsMean << ", \"ws_peak\": " << r.wsPeak
+       << ", \"suspensions\": " << r.suspensions << ", \"suspended_time\": " << r.suspendedTime << ", \"tlb_hit_ratio\": " << r.tlbHitRatio
+       << ", \"tlb_misses\": " << r.tlbMisses << ", \"tlb_flushes\": " << r.tlbFlushes << ", \"shootdowns\": " << r.shootdowns
+       << ", \"tlb_walk_time\": " << r.tlbWalkTime << ", \"shootdown_time\": " << r.shootdownTime << ", \"backlog\": " << r.backlog << ", \"table_bytes\": " << r.tableBytes << "},\n";
+    os << "  \"devices\": [";
+    for (size_t i = 0; i < r.devices.size(); i++) {
+        const SimResult::Device& d = r.devices[i];
+        os << (i ? ", " : "") << "{\"name\": \"" << d.name << "\", \"served\": " << d.served
+           << ", \"utilization\": " << d.utilization << ", \"avg_queue_wait\": " << d.avgQueueWait << "}";
+    }
+    os << "],\n";
+    os << "  \"cores\": [";
+    for (size_t i = 0; i < r.cores.size(); i++) {
+        const SimResult::Core& c = r.cores[i];
+        os << (i ? ", " : "") << "{\"cpu\": " << i << ", \"accesses\": " << c.accesses << ", \"hits\": " << c.hits
+           << ", \"hit_ratio\": " << c.hitRatio << "}";
+    }
+    os << "],\n";
+    os << "  \"wall_seconds\": " << wallSecs << "\n}\n";
+}
+
+// One headless run; the summary goes to summaryPath, or stdout if empty.
+static int runHeadless(const SimConfig& cfg, const std::string& summaryPath) {
+    if (cfg.processes == 0 && cfg.duration == 0) {
+        std::cerr << "Headless run needs processes > 0 or a duration\n";
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    SimResult r = runSimulation(cfg);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (summaryPath.empty()) { writeSummary(std::cout, cfg, r, secs); return 0; }
+    std::ofstream file(summaryPath);
+    if (!file) { std::cerr << "Cannot open " << summaryPath << "\n"; return 1; }
+    writeSummary(file, cfg, r, secs);
+    return 0;
 }
 
 /* =========================
-   BOUNDED BUFFER
+   PARAMETER SWEEP
    ========================= */
-class BoundedBuffer {
+class ThreadPool {
 private:
-    std::vector<Process*> buf;
-    int cap, head = 0, tail = 0;
-    sem_t empty, full;
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
     std::mutex mtx;
+    std::condition_variable cv, idle;
+    int pending = 0;
+    bool stopping = false;
 
-public:
-    explicit BoundedBuffer(int c) : buf(c, nullptr), cap(c) {
-        sem_init(&empty, 0, c);
-        sem_init(&full, 0, 0);
+    void worker() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--pending == 0) idle.notify_all();
+        }
     }
-    ~BoundedBuffer() {
-        sem_destroy(&empty);
-        sem_destroy(&full);
+
+public:
+    explicit ThreadPool(unsigned n) {
+        if (n == 0) n = 1;
+        for (unsigned i = 0; i < n; i++) workers.emplace_back(&ThreadPool::worker, this);
     }
 
-    void push(Process* p) {
-        sem_wait(&empty);
+    ~ThreadPool() {
         {
             std::lock_guard<std::mutex> lock(mtx);
-            buf[tail] = p;
-            tail = (tail + 1) % cap;
+            stopping = true;
         }
-        sem_post(&full);
+        cv.notify_all();
+        for (auto& w : workers) w.join();
     }
 
-    Process* pop() {
-        // Non-blocking check for stop signal
-        int val;
-        sem_getvalue(&full, &val);
-        if (val <= 0 && gStopAll) return nullptr;
-
-        // Using a simple wait logic to avoid sem_timedwait portability issues
-        while (true) {
-            if (sem_trywait(&full) == 0) break;
-            if (gStopAll) return nullptr;
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
-
-        Process* p;
+    void submit(std::function<void()> task) {
         {
             std::lock_guard<std::mutex> lock(mtx);
-            p = buf[head];
-            buf[head] = nullptr;
-            head = (head + 1) % cap;
+            tasks.push_back(std::move(task));
+            pending++;
         }
-        sem_post(&empty);
-        return p;
+        cv.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        idle.wait(lock, [this] { return pending == 0; });
     }
 };
 
+static unsigned hostThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Expands "quantum=1,2,4;buffer=5,10;policy=rr,fcfs" into the cartesian
+// product of configurations derived from base.
+static bool expandGrid(const std::string& grid, const SimConfig& base, std::vector<SimConfig>& out) {
+    out.assign(1, base);
+    std::stringstream axes(grid);
+    std::string axis;
+    while (std::getline(axes, axis, ';')) {
+        if (axis.empty()) continue;
+        size_t eq = axis.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = axis.substr(0, eq);
+        std::vector<SimConfig> next;
+        std::stringstream vals(axis.substr(eq + 1));
+        std::string val;
+        while (std::getline(vals, val, ',')) {
+            for (const SimConfig& c : out) {
+                SimConfig v = c;
+                if (!applyParam(v, key, val)) return false;
+                v.labels.push_back({ key, val });
+                next.push_back(v);
+            }
+        }
+        if (next.empty()) return false;
+        out.swap(next);
+    }
+    return true;
+}
+
+static void writeResultRow(std::ostream& os, const SimConfig& cfg, const SimResult& r) {
+    for (auto& l : cfg.labels) os << l.second << ",";
+    os << r.created << "," << r.completed << "," << r.stranded << "," << r.makespan << ","
+       << r.throughput << "," << r.avgWait << "," << r.waitP99 << "," << r.waitMax << ","
+       << r.avgTurnaround << "," << r.utilization << "," << r.switches << "," << r.switchTime << ","
+       << r.pageFaults << "," << r.evictions << "," << r.tlbMisses << "," << r.tlbWalkTime + r.shootdownTime << "\n";
+}
+
+static int runSweep(const std::string& grid, const SimConfig& base, const std::string& outPath, unsigned jobs) {
+    std::vector<SimConfig> configs;
+    SimConfig untraced = base;
+    untraced.tracePath.clear();
+    if (!expandGrid(grid, untraced, configs)) {
+        std::cerr << "Bad --sweep grid: " << grid << "\n";
+        return 1;
+    }
+    std::vector<SimResult> results(configs.size());
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(jobs ? jobs : hostThreads());
+        for (size_t i = 0; i < configs.size(); i++)
+            pool.submit([&configs, &results, i] { results[i] = runSimulation(configs[i]); });
+        pool.wait();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) { std::cerr << "Cannot open " << outPath << "\n"; return 1; }
+    }
+    std::ostream& os = outPath.empty() ? std::cout : file;
+    for (auto& l : configs[0].labels) os << l.first << ",";
+    os << "created,completed,stranded,makespan,throughput,avg_wait,wait_p99,wait_max,avg_turnaround,utilization,switches,switch_time,page_faults,evictions,tlb_misses,tlb_time\n";
+    for (size_t i = 0; i < configs.size(); i++) writeResultRow(os, configs[i], results[i]);
+    std::cerr << "Sweep: " << configs.size() << " configurations in " << secs << " s\n";
+    LockStats::report(std::cerr);
+    return 0;
+}
+
 /* =========================
-   RESOURCE MANAGER
+   REPLICATION
    ========================= */
-class ResourceManager {
-private:
-    std::vector<int> available;
-    std::map<int, std::vector<int>> allocMap;
-    std::mutex mtx;
+struct Estimate {
+    double mean = 0, half = 0; // 95% CI is mean +/- half
+};
 
-public:
-    ResourceManager(const std::vector<int>& avail) : available(avail) {}
+// Two-sided 95% Student t quantile.
+static double tCritical95(int df) {
+    static const double table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (df < 1) return 0;
+    if (df <= 30) return table[df - 1];
+    return 1.960 + 2.4 / df;
+}
 
-    bool requestResources(Process* p) {
-        std::lock_guard<std::mutex> lock(mtx);
-        for (size_t i = 0; i < available.size(); i++) {
-            if (p->maxDemand[i] > available[i]) return false;
+static Estimate estimate(const std::vector<double>& xs) {
+    Estimate e;
+    size_t n = xs.size();
+    if (n == 0) return e;
+    for (double x : xs) e.mean += x;
+    e.mean /= n;
+    if (n < 2) return e;
+    double ss = 0;
+    for (double x : xs) ss += (x - e.mean) * (x - e.mean);
+    e.half = tCritical95((int)n - 1) * std::sqrt(ss / (n - 1) / n);
+    return e;
+}
+
+static bool tightEnough(const Estimate& e, double relTol) {
+    return e.half <= relTol * std::fabs(e.mean);
+}
+
+// Runs up to maxReps independent replications of base with distinct seeds,
+// a pool-sized batch at a time, stopping once throughput, waiting time and
+// utilization all have a 95% CI half-width within relTol of their mean.
+static int runReplications(const SimConfig& base, int maxReps, double relTol, unsigned jobs, const std::string& outPath) {
+    const int kMinReps = 5;
+    unsigned threads = jobs ? jobs : hostThreads();
+    Rng seeds(base.seed, kStreamReplicas);
+    std::vector<SimConfig> configs;
+    std::vector<SimResult> results;
+    std::vector<double> thr, wait, util;
+    bool converged = false;
+
+    ThreadPool pool(threads);
+    while ((int)results.size() < maxReps && !converged) {
+        size_t first = results.size();
+        size_t batch = std::max<size_t>(threads, first == 0 ? kMinReps : 1);
+        batch = std::min<size_t>(batch, maxReps - first);
+        for (size_t i = 0; i < batch; i++) {
+            SimConfig c = base;
+            c.seed = seeds.next();
+            c.tracePath.clear();
+            c.labels = { { "replication", std::to_string(first + i) }, { "seed", std::to_string(c.seed) } };
+            configs.push_back(c);
         }
-        for (size_t i = 0; i < available.size(); i++) {
-            available[i] -= p->maxDemand[i];
+        results.resize(first + batch);
+        for (size_t i = first; i < first + batch; i++)
+            pool.submit([&configs, &results, i] { results[i] = runSimulation(configs[i]); });
+        pool.wait();
+
+        for (size_t i = first; i < results.size(); i++) {
+            thr.push_back(results[i].throughput);
+            wait.push_back(results[i].avgWait);
+            util.push_back(results[i].utilization);
         }
-        allocMap[p->pid] = p->maxDemand;
-        return true;
+        converged = (int)results.size() >= kMinReps && relTol > 0 &&
+            tightEnough(estimate(thr), relTol) && tightEnough(estimate(wait), relTol) &&
+            tightEnough(estimate(util), relTol);
     }
 
-    void releaseAll(Process* p) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (allocMap.count(p->pid)) {
-            for (size_t i = 0; i < available.size(); i++)
-                available[i] += allocMap[p->pid][i];
-            allocMap.erase(p->pid);
-        }
+    if (!outPath.empty()) {
+        std::ofstream file(outPath);
+        if (!file) { std::cerr << "Cannot open " << outPath << "\n"; return 1; }
+        file << "replication,seed,created,completed,stranded,makespan,throughput,avg_wait,wait_p99,wait_max,avg_turnaround,utilization,switches,switch_time,page_faults,evictions,tlb_misses,tlb_time\n";
+        for (size_t i = 0; i < results.size(); i++) writeResultRow(file, configs[i], results[i]);
     }
 
-    std::vector<int> getAvailable() {
-        std::lock_guard<std::mutex> lock(mtx);
-        return available;
+    std::cout << "Replications: " << results.size()
+              << (converged ? " (converged)" : " (limit reached)") << "\n";
+    std::cout << std::left << std::setw(14) << "metric" << std::setw(14) << "mean"
+              << std::setw(14) << "ci95 +/-" << "interval\n";
+    const char* names[] = { "throughput", "avg_wait", "utilization" };
+    const std::vector<double>* series[] = { &thr, &wait, &util };
+    for (int m = 0; m < 3; m++) {
+        Estimate e = estimate(*series[m]);
+        std::cout << std::setw(14) << names[m] << std::setw(14) << e.mean << std::setw(14) << e.half
+                  << "[" << e.mean - e.half << ", " << e.mean + e.half << "]\n";
     }
-};
+    std::cout << std::right;
+    LockStats::report(std::cout);
+    return 0;
+}
 
 /* =========================
-   SCHEDULER
+   METRICS ENDPOINT
    ========================= */
-class Scheduler {
+// Fixed-bucket latency histogram on relaxed atomics, in Prometheus form.
+class AtomicHistogram {
 private:
-    int quantum, time = 0;
-    std::deque<Process*> ready;
-    std::vector<std::pair<int, int>> gantt;
-    std::mutex mtx;
+    static const int kBuckets = 11;
+    const double bounds[kBuckets] = { 250e-9, 500e-9, 1e-6, 2.5e-6, 5e-6, 10e-6, 25e-6, 50e-6, 100e-6, 1e-3, 10e-3 };
+    std::atomic<unsigned long long> counts[kBuckets + 1];
+    std::atomic<unsigned long long> sumNs{ 0 };
 
 public:
-    explicit Scheduler(int q) : quantum(q) {}
+    AtomicHistogram() { for (auto& c : counts) c.store(0); }
 
-    void addReady(Process* p) {
-        std::lock_guard<std::mutex> lock(mtx);
-        ready.push_back(p);
+    void observe(long long ns) {
+        double secs = ns * 1e-9;
+        int b = 0;
+        while (b < kBuckets && secs > bounds[b]) b++;
+        counts[b].fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add((unsigned long long)ns, std::memory_order_relaxed);
     }
 
-    int readyCount() {
-        std::lock_guard<std::mutex> lock(mtx);
-        return (int)ready.size();
+    void write(std::ostream& os, const char* name, const char* help) const {
+        os << "# HELP " << name << " " << help << "\n# TYPE " << name << " histogram\n";
+        unsigned long long cum = 0;
+        for (int b = 0; b <= kBuckets; b++) {
+            cum += counts[b].load(std::memory_order_relaxed);
+            os << name << "_bucket{le=\"";
+            if (b < kBuckets) os << bounds[b]; else os << "+Inf";
+            os << "\"} " << cum << "\n";
+        }
+        os << name << "_sum " << sumNs.load(std::memory_order_relaxed) * 1e-9 << "\n";
+        os << name << "_count " << cum << "\n";
     }
+};
 
-    Process* dispatch() {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (ready.empty()) return nullptr;
+// Published by the interactive simulation threads; read without locks.
+struct Metrics {
+    static const int kMaxResources = 8;
+    std::atomic<long long> created{ 0 }, completed{ 0 }, requeued{ 0 };
+    std::atomic<int> bufferOccupancy{ 0 }, readyDepth{ 0 }, resourceTypes{ 0 };
+    std::atomic<int> available[kMaxResources];
+    AtomicHistogram dispatchLatency;
 
-        Process* p = ready.front();
-        ready.pop_front();
+    Metrics() { for (auto& a : available) a.store(0); }
 
-        int slice = std::min(quantum, p->remainingTime);
-        p->remainingTime -= slice;
-        gantt.push_back({ p->pid, slice });
-        time += slice;
+    void publishAvailable(const std::vector<int>& avail) {
+        int n = std::min((int)avail.size(), (int)kMaxResources);
+        for (int i = 0; i < n; i++) available[i].store(avail[i], std::memory_order_relaxed);
+        resourceTypes.store(n, std::memory_order_relaxed);
+    }
 
-        if (p->remainingTime > 0) {
-            ready.push_back(p);
-            return nullptr;
+    std::string render() const {
+        std::ostringstream os;
+        auto counter = [&os](const char* name, const char* help, long long v) {
+            os << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n" << name << " " << v << "\n";
+        };
+        auto gauge = [&os](const char* name, const char* help, long long v) {
+            os << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n" << name << " " << v << "\n";
+        };
+        counter("ossim_processes_created_total", "Processes created by the producer.", created.load());
+        counter("ossim_processes_completed_total", "Processes run to completion.", completed.load());
+        counter("ossim_processes_requeued_total", "Admissions refused for lack of resources.", requeued.load());
+        gauge("ossim_buffer_occupancy", "Processes waiting in the bounded buffer.", bufferOccupancy.load());
+        gauge("ossim_ready_queue_depth", "Processes in the scheduler ready queue.", readyDepth.load());
+        os << "# HELP ossim_resource_available Free units per resource type.\n# TYPE ossim_resource_available gauge\n";
+        for (int i = 0; i < resourceTypes.load(); i++)
+            os << "ossim_resource_available{type=\"" << i << "\"} " << available[i].load() << "\n";
+        dispatchLatency.write(os, "ossim_dispatch_latency_seconds", "Host time spent in Scheduler::dispatch.");
+        return os.str();
+    }
+};
+
+static Metrics gMetrics;
+
+// Minimal HTTP/1.0 server on 127.0.0.1 answering GET /metrics.
+class MetricsServer {
+private:
+    int fd = -1;
+    std::thread th;
+    std::atomic<bool> stopping{ false };
+
+    void serve() {
+        while (!stopping) {
+            pollfd pfd{ fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 200) <= 0) continue;
+            int conn = accept(fd, nullptr, nullptr);
+            if (conn < 0) continue;
+            // A client that never sends must not hold up stop(): wait for the
+            // request in short polls, for at most 2 s.
+            pollfd in{ conn, POLLIN, 0 };
+            int waited = 0;
+            while (!stopping && waited < 2000 && poll(&in, 1, 200) == 0) waited += 200;
+            if (!(in.revents & (POLLIN | POLLHUP | POLLERR))) {
+                close(conn);
+                continue;
+            }
+            char req[1024];
+            ssize_t n = recv(conn, req, sizeof(req) - 1, MSG_DONTWAIT);
+            req[n > 0 ? n : 0] = '\0';
+            std::string status = "200 OK", body;
+            // The whole path must match; a query string is allowed and ignored.
+            if (std::strncmp(req, "GET /metrics", 12) == 0 && (req[12] == ' ' || req[12] == '?'))
+                body = gMetrics.render();
+            else { status = "404 Not Found"; body = "try /metrics\n"; }
+            std::string resp = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            for (size_t off = 0; off < resp.size();) {
+                ssize_t w = send(conn, resp.data() + off, resp.size() - off, MSG_NOSIGNAL);
+                if (w <= 0) break;
+                off += (size_t)w;
+            }
+            close(conn);
         }
-        return p;
     }
 
-    void printGantt() {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (gantt.empty()) { std::cout << "\nGantt chart is empty.\n"; return; }
-        std::cout << "\n=== GANTT CHART ===\n|";
-        for (auto& g : gantt) std::cout << " P" << g.first << " |";
-        std::cout << "\n0";
-        int t = 0;
-        for (auto& g : gantt) { t += g.second; std::cout << std::setw(5) << t; }
-        std::cout << "\n";
+public:
+    ~MetricsServer() { stop(); }
+
+    bool start(int port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        th = std::thread(&MetricsServer::serve, this);
+        return true;
+    }
+
+    void stop() {
+        stopping = true;
+        if (th.joinable()) th.join();
+        if (fd >= 0) { close(fd); fd = -1; }
     }
 };
 
 /* =========================
    THREADS
    ========================= */
-void producerThread(BoundedBuffer* buf) {
-    while (!gStopAll) {
-        if (gRunning) {
-            int pid = __sync_fetch_and_add(&gPidCounter, 1);
-            Process* p = new Process(pid, 0, rndInt(2, 6), { rndInt(1, 2), rndInt(1, 2), rndInt(1, 2) });
-            buf->push(p);
-            {
-                std::lock_guard<std::mutex> lock(gIoMtx);
-                std::cout << "[Producer] Created PID " << pid << std::endl;
+// Creates processes until stopped or draining. One it created but could not
+// push before stopping is handed back for reclaiming.
+void producerThread(BoundedBuffer* buf, ProcessTable* table, PidAllocator* pids, const Workload* wl,
+                    TraceWriter* trace, KernelMemory* kmem, ProcHandle* handedBack) {
+    // Workload is drawn in batches from the producer's own stream.
+    const int kBatch = 64;
+    const int kRes = table->resourceTypes();
+    Rng rng(gSeed, kStreamProducer);
+    ArrivalProcess arrivals(wl->arrival);
+    int bursts[kBatch];
+    std::vector<int> demands(kBatch * kRes);
+    int next = kBatch;
+    double clock = 0;
+    PidAllocator::Batch pidBatch(pids);
+
+    while (gGate.waitRunnable() && !gGate.isDraining()) {
+        if (next == kBatch) {
+            wl->burst.fill(rng, bursts, kBatch);
+            rng.fillInt(demands.data(), demands.size(), wl->demandLo, wl->demandHi);
+            next = 0;
+        }
+        int pid = pids->alloc(pidBatch);
+        if (pid < 0) { // every PID is live: wait for exits
+            gGate.sleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+            continue;
+        }
+        const int* d = demands.data() + next * kRes;
+        ProcHandle p = table->create(pid, (long long)clock, bursts[next], d);
+        if (p == kNoProc) { pids->release(pid); break; } // table full
+        if (kmem) {
+            long long t0 = nowNs();
+            bool ok = kmem->allocFor(ProcessTable::index(p));
+            gLatency.record(kLatKmemAlloc, nowNs() - t0);
+            if (!ok) { // out of kernel memory: wait for exits
+                pids->release(table->release(p));
+                gGate.sleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+                continue;
+            }
+        }
+        next++;
+        table->hostNs(p) = nowNs();
+        if (trace->isOpen()) {
+            long long ts = trace->hostUs();
+            trace->instant(TraceWriter::kHostProducer, "create", pid, ts);
+            trace->flow('s', TraceWriter::kHostProducer, pid, ts);
+        }
+        if (!buf->push(p)) { *handedBack = p; break; } // stopped or draining while the buffer was full
+        gMetrics.created.fetch_add(1, std::memory_order_relaxed);
+        gMetrics.bufferOccupancy.store(buf->size(), std::memory_order_relaxed);
+        LOG_INFO("Producer", "Created PID", pid);
+        double gap = arrivals.nextGap(rng, clock);
+        clock += gap;
+        gGate.sleepUntil(std::chrono::steady_clock::now() +
+                         std::chrono::microseconds((long long)(gap * wl->msPerUnit * 1000)));
+    }
+}
+
+// Runs until stopped, or when draining until the buffer and ready queue are
+// empty. A process it still holds at exit is handed back for reclaiming.
+void cpuThread(BoundedBuffer* buf, ProcessTable* table, PidAllocator* pids, ResourceManager* rm,
+               Scheduler* sch, TraceWriter* trace, KernelMemory* kmem, std::vector<ProcHandle>* handedBack) {
+    ProcHandle held = kNoProc; // refused admission and the buffer filled up meanwhile
+
+    auto dispatchOne = [&](int pid) {
+        long long t0 = nowNs();
+        ProcHandle finished = sch->dispatch();
+        long long dispatchNs = nowNs() - t0;
+        gMetrics.dispatchLatency.observe(dispatchNs);
+        gLatency.record(kLatDispatch, dispatchNs);
+        if (trace->isOpen()) {
+            long long durUs = std::max(1LL, dispatchNs / 1000);
+            trace->complete(TraceWriter::kHostPid, TraceWriter::kHostCpu, "host", "dispatch",
+                            pid, trace->hostUs() - durUs, durUs);
+        }
+        if (finished != kNoProc) {
+            rm->releaseAll(finished);
+            gMetrics.publishAvailable(rm->getAvailable());
+            gMetrics.completed.fetch_add(1, std::memory_order_relaxed);
+            LOG_INFO("CPU", "Completed PID", table->pid(finished));
+            if (kmem) kmem->freeFor(ProcessTable::index(finished));
+            pids->release(table->release(finished));
+        }
+        gMetrics.readyDepth.store(sch->readyCount(), std::memory_order_relaxed);
+        gMetrics.bufferOccupancy.store(buf->size(), std::memory_order_relaxed);
+    };
+
+    while (gGate.waitRunnable()) {
+        ProcHandle p = held != kNoProc ? held : buf->pop();
+        held = kNoProc;
+        if (p == kNoProc) {
+            // pop() comes back empty-handed once input is closed: finish the ready queue.
+            if (gGate.isInputClosed()) {
+                if (sch->readyCount() == 0) break;
+                dispatchOne(-1);
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+            continue;
+        }
+        if (!table->valid(p)) {
+            LOG_WARN("CPU", "Dropped stale handle", (int)p);
+            continue;
+        }
+        long long popped = nowNs();
+        int pid = table->pid(p);
+        if (!(table->flags(p) & kProcTried)) {
+            gLatency.record(kLatBufferWait, popped - table->hostNs(p));
+            table->hostNs(p) = popped;
+            table->flags(p) |= kProcTried;
+            if (trace->isOpen()) trace->flow('f', TraceWriter::kHostCpu, pid, trace->hostUs());
+        }
+        if (rm->requestResources(p)) {
+            gLatency.record(kLatResourceWait, nowNs() - table->hostNs(p));
+            sch->addReady(p);
+            gMetrics.publishAvailable(rm->getAvailable());
+            LOG_INFO("CPU", "Assigned resources to PID", pid);
+            dispatchOne(pid);
         }
         else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            gMetrics.requeued.fetch_add(1, std::memory_order_relaxed);
+            if (!buf->tryPush(p)) held = p; // Re-queue if resources aren't available
+            if (gGate.isDraining() && sch->readyCount() > 0) {
+                dispatchOne(-1); // free resources instead of waiting for them
+                continue;
+            }
+            long long ts = trace->isOpen() ? trace->hostUs() : 0;
+            gGate.sleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(500));
+            if (trace->isOpen())
+                trace->complete(TraceWriter::kHostPid, TraceWriter::kHostCpu, "host", "resource wait",
+                                pid, ts, trace->hostUs() - ts);
         }
     }
+    if (held != kNoProc) handedBack->push_back(held);
+    gGate.markDrained();
 }
 
-void cpuThread(BoundedBuffer* buf, ResourceManager* rm, Scheduler* sch) {
-    while (!gStopAll) {
-        if (gRunning) {
-            Process* p = buf->pop();
-            if (p) {
-                if (rm->requestResources(p)) {
-                    sch->addReady(p);
-                    {
-                        std::lock_guard<std::mutex> lock(gIoMtx);
-                        std::cout << "[CPU] Assigned resources to PID " << p->pid << std::endl;
-                    }
-                    if (Process* finished = sch->dispatch()) {
-                        rm->releaseAll(finished);
-                        {
-                            std::lock_guard<std::mutex> lock(gIoMtx);
-                            std::cout << "[CPU] Completed PID " << finished->pid << std::endl;
-                        }
-                        delete finished;
-                    }
-                }
-                else {
-                    buf->push(p); // Re-queue if resources aren't available
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+/* =========================
+   BENCHMARKS
+   ========================= */
+// Per-event cost on the logging thread of the old console path (gIoMtx +
+// std::endl) against the log ring, both writing to /dev/null from several
+// threads. Bursts fit in a ring and the writer drains between rounds, so the
+// ring figure is for accepted records, not the cheaper drop path.
+static void benchLog() {
+    const int kThreads = 4, kRounds = 50, kBurst = 4000;
+    std::ofstream devnull("/dev/null");
+    Logger& log = Logger::instance();
+    // One set of workers runs every round, so each registers a single log
+    // ring; between rounds they wait while the writer drains.
+    auto timeRounds = [&](std::function<void()> body, bool drain) {
+        std::atomic<long long> ns{ 0 };
+        std::mutex m;
+        std::condition_variable cv;
+        int round = -1, done = 0;
+        std::vector<std::thread> ts;
+        for (int t = 0; t < kThreads; t++) ts.emplace_back([&] {
+            for (int r = 0; r < kRounds; r++) {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&] { return round >= r; });
                 }
+                auto start = std::chrono::steady_clock::now();
+                body();
+                ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                std::lock_guard<std::mutex> lock(m);
+                if (++done == kThreads) cv.notify_all();
             }
+        });
+        for (int r = 0; r < kRounds; r++) {
+            std::unique_lock<std::mutex> lock(m);
+            done = 0;
+            round = r;
+            cv.notify_all();
+            cv.wait(lock, [&] { return done == kThreads; });
+            lock.unlock();
+            if (drain) { log.stop(); log.start(); }
+        }
+        for (auto& t : ts) t.join();
+        return (double)ns / ((double)kThreads * kRounds * kBurst);
+    };
+
+    double direct = timeRounds([&] {
+        for (int i = 0; i < kBurst; i++) {
+            std::lock_guard<SimMutex> lock(gIoMtx);
+            devnull << "[CPU] Completed PID " << i << std::endl;
+        }
+    }, false);
+
+    log.stop();
+    log.setSink(&devnull);
+    log.start();
+    unsigned long long droppedBefore = log.dropped();
+    double ring = timeRounds([&] {
+        for (int i = 0; i < kBurst; i++) LOG_INFO("CPU", "Completed PID", i);
+    }, true);
+    log.stop();
+    log.setSink(&std::cout);
+
+    std::cout << "log: cout+endl under gIoMtx " << direct << " ns/event, ring " << ring
+              << " ns/event (" << direct / ring << "x), dropped " << log.dropped() - droppedBefore << "\n";
+}
+
+// PID allocation from several producer threads: the old shared fetch-and-add
+// counter (no recycling), the bitmap allocator taking its lock per PID, and
+// the same allocator through per-thread batches. Each thread keeps 64 PIDs
+// live and releases them together, so the bitmap keeps wrapping and reusing.
+static void benchPids() {
+    const int kThreads = 4, kPerThread = 2000000, kHeld = 64;
+    auto timeThreads = [&](std::function<void()> body) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> ts;
+        for (int t = 0; t < kThreads; t++) ts.emplace_back(body);
+        for (auto& t : ts) t.join();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+               ((double)kThreads * kPerThread);
+    };
+
+    int counter = 1;
+    double shared = timeThreads([&] {
+        for (int i = 0; i < kPerThread; i++) __sync_fetch_and_add(&counter, 1);
+    });
+
+    PidAllocator locked(32768);
+    double perCall = timeThreads([&] {
+        int held[kHeld];
+        for (int i = 0; i < kPerThread; i++) {
+            held[i % kHeld] = locked.alloc();
+            if (i % kHeld == kHeld - 1) locked.releaseMany(held, kHeld);
+        }
+    });
+
+    PidAllocator batched(32768);
+    double perBatch = timeThreads([&] {
+        PidAllocator::Batch batch(&batched);
+        int held[kHeld];
+        for (int i = 0; i < kPerThread; i++) {
+            held[i % kHeld] = batched.alloc(batch);
+            if (i % kHeld == kHeld - 1) batched.releaseMany(held, kHeld);
+        }
+    });
+
+    std::cout << "pids (" << kThreads << " threads): shared counter " << shared << " ns/pid, bitmap per call "
+              << perCall << " ns/pid, bitmap with batches of " << PidAllocator::kBatch << " " << perBatch
+              << " ns/pid (alloc + release), " << locked.allocated() + batched.allocated() << " left allocated\n";
+}
+
+struct BenchTimer {
+    long long time;
+    uint64_t seq;
+    bool operator>(const BenchTimer& o) const { return time != o.time ? time > o.time : seq > o.seq; }
+};
+
+// Classic hold model: n outstanding events, each step pops the earliest and
+// re-inserts it gap(rng) ticks later. Returns ns per step.
+static double holdModel(const std::string& kind, int n, int steps, std::function<long long(Rng&)> gap) {
+    std::unique_ptr<EventList<BenchTimer>> list = makeEventList<BenchTimer>(kind);
+    Rng rng(42, kStreamProducer);
+    uint64_t seq = 0;
+    for (int i = 0; i < n; i++) list->push(BenchTimer{ gap(rng), seq++ });
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) {
+        long long t = list->top().time;
+        list->pop();
+        list->push(BenchTimer{ t + gap(rng), seq++ });
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / steps;
+}
+
+// Hold model with timers re-armed 1..kHorizon ticks out, then the wheel's
+// insert+cancel, which the heap cannot do without lazy deletion.
+static void benchTimers() {
+    const int kHorizon = 100000, kSteps = 2000000;
+    const int sizes[] = { 10000, 1000000, 4000000 };
+    auto gap = [](Rng& rng) { return (long long)rng.uniformInt(1, kHorizon); };
+    for (int n : sizes) {
+        double heap = holdModel("heap", n, kSteps, gap), wheel = holdModel("wheel", n, kSteps, gap);
+        std::cout << "timers: " << n << " outstanding, hold: heap " << heap << " ns/op, wheel " << wheel
+                  << " ns/op (" << heap / wheel << "x)\n";
+    }
+
+    TimingWheel<BenchTimer> wheel;
+    Rng rng(42, kStreamProducer);
+    const int n = 4000000;
+    std::vector<TimingWheel<BenchTimer>::TimerId> ids(n);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) ids[i] = wheel.insert(BenchTimer{ rng.uniformInt(1, kHorizon), (uint64_t)i });
+    for (int i = 0; i < n; i++) wheel.cancel(ids[i]);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    std::cout << "timers: wheel insert+cancel " << ns << " ns/timer at " << n << " outstanding\n";
+}
+
+// Heap, timing wheel and calendar queue under the hold model across
+// event counts and gap distributions: exponential, uniform, bimodal (mostly
+// short, some very long) and heavy ties (gaps of 0..3 ticks).
+static void benchEventList() {
+    const int kSteps = 1000000;
+    const int sizes[] = { 10, 1000, 100000, 1000000 };
+    const char* kinds[] = { "heap", "wheel", "calendar" };
+    struct Dist {
+        const char* name;
+        std::function<long long(Rng&)> gap;
+    };
+    std::vector<Dist> dists = {
+        { "exp:1000", [](Rng& r) { return (long long)std::ceil(sampleExp(r, 1.0 / 1000)); } },
+        { "uniform:1:2000", [](Rng& r) { return (long long)r.uniformInt(1, 2000); } },
+        { "bimodal", [](Rng& r) { return (long long)(r.uniform01() < 0.9 ? r.uniformInt(1, 100) : r.uniformInt(1, 1000000)); } },
+        { "ties:0:3", [](Rng& r) { return (long long)r.uniformInt(0, 3); } },
+    };
+    std::cout << std::left << std::setw(16) << "gaps" << std::right << std::setw(9) << "events";
+    for (const char* k : kinds) std::cout << std::setw(12) << k;
+    std::cout << "   (ns per hold step)\n";
+    for (const Dist& d : dists) {
+        for (int n : sizes) {
+            std::cout << std::left << std::setw(16) << d.name << std::right << std::setw(9) << n;
+            for (const char* k : kinds) std::cout << std::setw(12) << std::fixed << std::setprecision(1) << holdModel(k, n, kSteps, d.gap);
+            std::cout << "\n";
         }
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+// Cache model throughput: one AccessStream through one SetAssocCache, for
+// each policy, an L1-sized and an L2-sized geometry, and a working set that
+// fits versus one that does not.
+static void benchCache() {
+    const long long kRefs = 50000000;
+    const char* geos[] = { "lru:32768:8:64", "plru:32768:8:64", "lru:1048576:16:64", "plru:1048576:16:64" };
+    const char* pats[] = { "stride:16384:8:0.02", "random:16384", "stride:67108864:8:0.02", "random:67108864" };
+    for (const char* g : geos) {
+        CacheGeometry geo;
+        geo.parse(g);
+        for (const char* pt : pats) {
+            AccessPattern pat;
+            pat.parse(pt);
+            SetAssocCache cache(geo);
+            AccessStream stream(&pat, 42, 0);
+            auto start = std::chrono::steady_clock::now();
+            long long hits = stream.run(cache, kRefs);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "cache " << std::left << std::setw(20) << g << std::setw(24) << pt << std::right
+                      << std::setw(8) << std::fixed << std::setprecision(1) << kRefs / secs / 1e6 << " M refs/s, hit ratio "
+                      << std::setprecision(3) << (double)hits / kRefs << "\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+    std::cout << std::setprecision(6);
+}
+
+// Long randomized process churn against the kernel allocators: Poisson
+// arrivals and exponential lifetimes sized so the live processes ask for
+// about 95% of memory, each holding a PCB, stack and buffer as in the
+// interactive simulator. Reports fragmentation and per-call latency (which
+// includes ~20 ns of clock reads) at four checkpoints.
+static void benchKmem() {
+    const long long kProcs = 4000000;
+    const double kLifetime = 1000;
+    KmemConfig cfg;
+    cfg.frames = 1 << 18;
+    ProcessTable table(3);
+    KernelMemory kmem(cfg, (uint32_t)table.rowBytes(), 42);
+    double meanFrames = 2;
+    for (int o = 0; o <= cfg.maxOrder; o++) meanFrames += (double)(1 << o) / (cfg.maxOrder + 1);
+    double rate = 0.95 * cfg.frames / meanFrames / kLifetime;
+    Rng rng(42, kStreamProducer);
+    typedef std::pair<double, uint32_t> Exit;
+    std::priority_queue<Exit, std::vector<Exit>, std::greater<Exit>> exits;
+    std::vector<uint32_t> freeRows;
+    uint32_t rows = 0;
+    HdrHistogram allocNs, freeNs;
+    double t = 0;
+    for (long long i = 1; i <= kProcs; i++) {
+        t += sampleExp(rng, rate);
+        while (!exits.empty() && exits.top().first <= t) {
+            uint32_t row = exits.top().second;
+            exits.pop();
+            long long t0 = nowNs();
+            kmem.freeFor(row);
+            freeNs.record((uint64_t)(nowNs() - t0));
+            freeRows.push_back(row);
+        }
+        uint32_t row = rows;
+        if (freeRows.empty()) rows++;
         else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            row = freeRows.back();
+            freeRows.pop_back();
         }
+        long long t0 = nowNs();
+        bool ok = kmem.allocFor(row);
+        allocNs.record((uint64_t)(nowNs() - t0));
+        if (ok) exits.push(Exit(t + sampleExp(rng, 1 / kLifetime), row));
+        else freeRows.push_back(row);
+        if (i % (kProcs / 4) == 0) {
+            std::cout << "kmem after " << i << " processes, " << exits.size() << " live\n";
+            kmem.report(std::cout);
+            std::cout << "  alloc ns p50 " << allocNs.percentile(50) << " p99 " << allocNs.percentile(99) << " p999 "
+                      << allocNs.percentile(99.9) << " max " << allocNs.max() << "; free ns p50 " << freeNs.percentile(50)
+                      << " p99 " << freeNs.percentile(99) << " p999 " << freeNs.percentile(99.9) << " max " << freeNs.max() << "\n";
+        }
+    }
+}
+
+static int runBench(const std::string& name) {
+    if (name == "log") benchLog();
+    else if (name == "pids") benchPids();
+    else if (name == "timers") benchTimers();
+    else if (name == "eventlist") benchEventList();
+    else if (name == "cache") benchCache();
+    else if (name == "kmem") benchKmem();
+    else {
+        std::cerr << "Unknown benchmark: " << name << "\n";
+        return 1;
     }
+    return 0;
 }
 
 /* =========================
    MAIN
    ========================= */
-int main() {
-    BoundedBuffer buffer(10);
-    ResourceManager rm({ 10, 10, 10 });
-    Scheduler scheduler(2);
+int main(int argc, char** argv) {
+    SimConfig simCfg;
+    std::string sweepGrid, outPath, benchName, summaryPath;
+    unsigned jobs = 0;
+    int replications = 0, metricsPort = 0;
+    double ciTol = 0.02;
+    bool headless = false, seeded = false, drainOnExit = true;
+    int drainTimeoutMs = 5000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        long long n = 0;
+        if (arg == "--headless") headless = true;
+        else if (arg == "--config" && hasValue) {
+            if (!loadConfigFile(argv[++i], simCfg, &seeded)) return 1;
+        }
+        else if (arg == "--sweep" && hasValue) sweepGrid = argv[++i];
+        else if (arg == "--replicate" && hasValue && parseInt(argv[i + 1], 1, INT_MAX, &n)) {
+            replications = (int)n;
+            i++;
+        }
+        else if (arg == "--ci-tol" && hasValue && parseReal(argv[i + 1], 0, &ciTol)) i++;
+        else if (arg == "--metrics-port" && hasValue && parseInt(argv[i + 1], 1, 65535, &n)) {
+            metricsPort = (int)n;
+            i++;
+        }
+        else if (arg == "--bench" && hasValue) benchName = argv[++i];
+        else if (arg == "--shutdown" && hasValue && (std::string(argv[i + 1]) == "drain" || std::string(argv[i + 1]) == "reclaim"))
+            drainOnExit = std::string(argv[++i]) == "drain";
+        else if (arg == "--drain-timeout" && hasValue && parseInt(argv[i + 1], 0, INT_MAX, &n)) {
+            drainTimeoutMs = (int)n;
+            i++;
+        }
+        else if (arg == "--summary" && hasValue) summaryPath = argv[++i];
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--jobs" && hasValue && parseInt(argv[i + 1], 1, INT_MAX, &n)) {
+            jobs = (unsigned)n;
+            i++;
+        }
+        else if (arg.compare(0, 2, "--") == 0 && hasValue && applyParam(simCfg, arg.substr(2), argv[i + 1])) {
+            if (arg == "--seed") seeded = true;
+            i++;
+        }
+        else {
+            std::cerr << "Unknown or invalid option: " << arg << (hasValue ? std::string(" ") + argv[i + 1] : "") << "\n";
+            return 1;
+        }
+    }
+    if (!seeded) simCfg.seed = ((uint64_t)std::random_device{}() << 32) ^ std::random_device{}();
+    gSeed = simCfg.seed;
+    if (!benchName.empty()) return runBench(benchName);
+    if (!sweepGrid.empty()) return runSweep(sweepGrid, simCfg, outPath, jobs);
+    if (replications > 0) return runReplications(simCfg, replications, ciTol, jobs, outPath);
+    if (headless) return runHeadless(simCfg, summaryPath);
+
+    std::cout << "Seed: " << gSeed << " (rerun with --seed " << gSeed << " to reproduce)\n";
+
+    ProcessTable table((int)simCfg.resources.size());
+    PidAllocator pids(simCfg.pidMax);
+    BoundedBuffer buffer(simCfg.bufferCap);
+    ResourceManager rm(simCfg.resources, &table);
+    Scheduler scheduler(simCfg.quantum, simCfg.policy, &table, 1, simCfg.switchCost);
+    std::unique_ptr<KernelMemory> kmem;
+    if (simCfg.kmem.frames > 0) kmem.reset(new KernelMemory(simCfg.kmem, (uint32_t)table.rowBytes(), gSeed));
 
-    std::thread prod(producerThread, &buffer);
-    std::thread cpu(cpuThread, &buffer, &rm, &scheduler);
+    gMetrics.publishAvailable(rm.getAvailable());
+    MetricsServer metricsServer;
+    if (metricsPort > 0) {
+        if (metricsServer.start(metricsPort))
+            std::cout << "Metrics at http://127.0.0.1:" << metricsPort << "/metrics\n";
+        else
+            std::cerr << "Cannot listen on 127.0.0.1:" << metricsPort << "\n";
+    }
+
+    TraceWriter trace;
+    if (!simCfg.tracePath.empty()) {
+        if (!trace.open(simCfg.tracePath)) { std::cerr << "Cannot open " << simCfg.tracePath << "\n"; return 1; }
+        trace.processName(TraceWriter::kSimPid, "Simulated CPUs");
+        trace.threadName(TraceWriter::kSimPid, 0, "CPU 0");
+        trace.processName(TraceWriter::kHostPid, "Host threads");
+        trace.threadName(TraceWriter::kHostPid, TraceWriter::kHostProducer, "producerThread");
+        trace.threadName(TraceWriter::kHostPid, TraceWriter::kHostCpu, "cpuThread");
+        scheduler.setTrace(&trace);
+    }
+
+    Logger::instance().start();
+    ProcHandle producerHeld = kNoProc;
+    std::thread prod(producerThread, &buffer, &table, &pids, &simCfg.workload, &trace, kmem.get(), &producerHeld);
+    std::vector<ProcHandle> handedBack;
+    std::thread cpu(cpuThread, &buffer, &table, &pids, &rm, &scheduler, &trace, kmem.get(), &handedBack);
 
     int choice = 0;
     while (choice != 5) {
         {
-            std::lock_guard<std::mutex> lock(gIoMtx);
+            std::lock_guard<SimMutex> lock(gIoMtx);
             std::cout << "\n========= OS SIMULATOR =========";
-            std::cout << "\nStatus: " << (gRunning ? "RUNNING" : "PAUSED");
+            std::cout << "\nStatus: " << (gGate.isRunning() ? "RUNNING" : "PAUSED");
             std::cout << "\n1) Run Simulation";
             std::cout << "\n2) Pause Simulation";
             std::cout << "\n3) View System State";
@@ -270,22 +4818,67 @@ int main() {
         if (!(std::cin >> choice)) break;
 
         switch (choice) {
-        case 1: gRunning = true; break;
-        case 2: gRunning = false; break;
+        case 1: gGate.run(); break;
+        case 2: gGate.pause(); break;
         case 3: {
             auto a = rm.getAvailable();
-            std::cout << "\n--- Resources Available: [" << a[0] << ", " << a[1] << ", " << a[2] << "]";
-            std::cout << "\n--- Processes in Ready Queue: " << scheduler.readyCount() << std::endl;
+            std::cout << "\n--- Resources Available: [";
+            for (size_t r = 0; r < a.size(); r++) std::cout << (r ? ", " : "") << a[r];
+            std::cout << "]";
+            std::cout << "\n--- Processes in Ready Queue: " << scheduler.readyCount();
+            std::cout << "\n--- Live Processes: " << table.liveCount() << " (" << table.size() << " table rows)";
+            long long states[kProcStates];
+            table.countStates(states);
+            std::cout << "\n--- Process States:";
+            for (int k = 0; k < kProcStates; k++) std::cout << " " << stateName((ProcState)k) << " " << states[k];
+            std::cout << "\n--- PIDs Allocated: " << pids.allocated() << " of " << pids.max() - 1 << "\n\n";
+            if (kmem) kmem->report(std::cout);
+            gLatency.report(std::cout);
             break;
         }
         case 4: scheduler.printGantt(); break;
-        case 5: gStopAll = true; gRunning = true; break;
         }
     }
 
+    // Exit (or end of input): drain queued work within the timeout if asked,
+    // then stop and reclaim whatever is left so nothing leaks.
+    auto shutdownStart = std::chrono::steady_clock::now();
+    long long completedBefore = gMetrics.completed.load();
+    bool drained = false;
+    if (drainOnExit) {
+        gGate.drain();
+        if (prod.joinable()) prod.join();
+        gGate.closeInput();
+        drained = gGate.waitDrained(shutdownStart + std::chrono::milliseconds(drainTimeoutMs));
+    }
+    gGate.stop();
     if (prod.joinable()) prod.join();
     if (cpu.joinable()) cpu.join();
 
+    long long fromBuffer = 0, fromReady = 0, fromCpu = (long long)handedBack.size();
+    long long fromProducer = producerHeld != kNoProc ? 1 : 0;
+    auto reclaim = [&](ProcHandle p) {
+        if (kmem) kmem->freeFor(ProcessTable::index(p));
+        pids.release(table.release(p));
+    };
+    for (ProcHandle p; (p = buffer.tryPop()) != kNoProc; fromBuffer++) reclaim(p);
+    for (ProcHandle p : scheduler.takeAll()) { rm.releaseAll(p); reclaim(p); fromReady++; }
+    for (ProcHandle p : handedBack) reclaim(p);
+    if (producerHeld != kNoProc) reclaim(producerHeld);
+    double shutdownMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shutdownStart).count();
+    Logger::instance().stop();
+    metricsServer.stop();
+    trace.close();
+
+    LockStats::report(std::cout);
+    if (kmem) {
+        std::cout << "\n";
+        kmem->report(std::cout);
+    }
+    std::cout << "\nShutdown (" << (drainOnExit ? (drained ? "drained" : "drain timed out") : "reclaim") << ") in "
+              << shutdownMs << " ms: " << gMetrics.completed.load() - completedBefore << " completed while draining, "
+              << fromBuffer + fromReady + fromCpu + fromProducer << " dropped (" << fromBuffer << " buffered, "
+              << fromReady << " ready, " << fromCpu << " held by CPU, " << fromProducer << " held by producer)\n";
     std::cout << "Simulation terminated safely.\n";
     return 0;
 }
\ No newline at end of file